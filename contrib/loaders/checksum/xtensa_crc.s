@@ -0,0 +1,62 @@
+/***************************************************************************
+ *   Xtensa CRC32 algorithm                                                *
+ *   Copyright (C) 2020 Espressif Systems Ltd.                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+/*
+	CRC32 (poly 0x04C11DB7, MSB first, as per gdb) of word aligned memory
+	range. Memory is read by words only, because some Xtensa memories
+	(IRAM, flash cache) do not support byte access. Bytes of every word
+	are processed in memory order (little endian).
+	Code does not use windowed calls, so it is run directly by
+	xtensa_run_algorithm() and stops at the final break instruction.
+
+	parameters:
+	a2 - start address, word aligned
+	a3 - end address, word aligned
+	a4 - CRC table address (256 words)
+	a5 - initial CRC in - CRC out
+*/
+
+	.text
+	.align	4
+	/* keep wide instructions, binary in xtensa_crc.inc must not depend on assembler options */
+	.begin	no-transform
+
+xtensa_crc:
+	bgeu	a2, a3, done
+word:
+	l32i	a6, a2, 0
+	movi	a7, 4
+byte:
+	extui	a8, a5, 24, 8
+	extui	a9, a6, 0, 8
+	xor	a8, a8, a9
+	addx4	a8, a8, a4
+	l32i	a8, a8, 0
+	slli	a5, a5, 8
+	xor	a5, a5, a8
+	srli	a6, a6, 8
+	addi	a7, a7, -1
+	bnez	a7, byte
+	addi	a2, a2, 4
+	bltu	a2, a3, word
+done:
+	break	0, 0
+
+	.end	no-transform
@@ -403,6 +403,59 @@ static int stub_flash_erase_check(uint32_t start_sec, uint32_t sec_num, uint8_t
 	return ret;
 }
 
+/* CRC32 with 0x04C11DB7 polynomial, MSB first, no final XOR. The same as used by GDB and OpenOCD's
+ * image_calculate_checksum(), so host can compare results directly. */
+static uint32_t stub_crc32(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+	static const uint32_t crc32_nibble_table[16] = {
+		0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9,
+		0x130476DC, 0x17C56B6B, 0x1A864DB2, 0x1E475005,
+		0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61,
+		0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD
+	};
+
+	while (len--) {
+		crc ^= (uint32_t)(*buf++) << 24;
+		crc = (crc << 4) ^ crc32_nibble_table[crc >> 28];
+		crc = (crc << 4) ^ crc32_nibble_table[crc >> 28];
+	}
+	return crc;
+}
+
+/* Calculates CRC32 of every sector's part which falls into the [addr, addr + size) range */
+static int stub_flash_calc_hash(uint32_t addr, uint32_t size, uint32_t *hashes)
+{
+	uint8_t buf[STUB_FLASH_SECTOR_SIZE / 8];/* implying that sector size is multiple of
+						 * sizeof(buf) */
+	uint32_t end_addr = addr + size;
+
+	STUB_LOGD("calc hash @ 0x%x, sz %d\n", addr, size);
+
+	for (uint32_t i = 0; addr < end_addr; i++) {
+		uint32_t sec_end = (addr & ~(STUB_FLASH_SECTOR_SIZE - 1)) + STUB_FLASH_SECTOR_SIZE;
+		uint32_t chunk_end = sec_end < end_addr ? sec_end : end_addr;
+		uint32_t crc = 0xFFFFFFFF;
+		while (addr < chunk_end) {
+			uint32_t rd_sz = chunk_end - addr > sizeof(buf) ? sizeof(buf) : chunk_end - addr;
+			/* flash reads must be word aligned, unused tail bytes are not hashed */
+			esp_rom_spiflash_result_t rc = esp_rom_spiflash_read(addr,
+				(uint32_t *)buf,
+				(rd_sz + 3) & ~0x3UL);
+			if (rc != ESP_ROM_SPIFLASH_RESULT_OK) {
+				STUB_LOGE("Failed to read flash (%d)!\n", rc);
+				return ESP_XTENSA_STUB_ERR_FAIL;
+			}
+			crc = stub_crc32(crc, buf, rd_sz);
+			addr += rd_sz;
+		}
+		hashes[i] = crc;
+	}
+
+	STUB_LOGD("hash calculated\n");
+
+	return ESP_XTENSA_STUB_ERR_OK;
+}
+
 static uint32_t stub_flash_get_size(void)
 {
 	uint32_t size = 0;
@@ -707,6 +760,9 @@ static int stub_flash_handler(int cmd, va_list ap)
 		case ESP_XTENSA_STUB_CMD_FLASH_WRITE:
 			ret = stub_flash_write(arg1, arg2, arg3, arg4);
 			break;
+		case ESP_XTENSA_STUB_CMD_FLASH_CALC_HASH:
+			ret = stub_flash_calc_hash(arg1, arg2, (uint32_t *)arg3);
+			break;
 		case ESP_XTENSA_STUB_CMD_FLASH_MAP_GET:
 			ret = stub_flash_get_map(arg1, arg2);
 			break;
@@ -768,7 +824,7 @@ int stub_main(int cmd, ...)
 	STUB_LOGD("cmd %d\n", cmd);
 
 	va_start(ap, cmd);
-	if (cmd <= ESP_XTENSA_STUB_CMD_FLASH_MAX_ID)
+	if (cmd <= ESP_XTENSA_STUB_CMD_FLASH_MAX_ID && cmd != ESP_XTENSA_STUB_CMD_TEST)
 		ret = stub_flash_handler(cmd, ap);
 	else
 		switch (cmd) {
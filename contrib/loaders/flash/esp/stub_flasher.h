@@ -34,8 +34,11 @@
 #define ESP_XTENSA_STUB_CMD_FLASH_BP_SET        6
 #define ESP_XTENSA_STUB_CMD_FLASH_BP_CLEAR      7
 #define ESP_XTENSA_STUB_CMD_FLASH_TEST          8
-#define ESP_XTENSA_STUB_CMD_FLASH_MAX_ID        ESP_XTENSA_STUB_CMD_FLASH_TEST
-#define ESP_XTENSA_STUB_CMD_TEST                (ESP_XTENSA_STUB_CMD_FLASH_MAX_ID+2)
+/* 9 is unused, 10 is taken by ESP_XTENSA_STUB_CMD_TEST */
+#define ESP_XTENSA_STUB_CMD_FLASH_CALC_HASH     11
+#define ESP_XTENSA_STUB_CMD_FLASH_MAX_ID        ESP_XTENSA_STUB_CMD_FLASH_CALC_HASH
+/* fixed, so host and stub built from different sources agree on it */
+#define ESP_XTENSA_STUB_CMD_TEST                10
 
 #define ESP_XTENSA_STUB_FLASH_MAPPINGS_MAX_NUM  2	/* IROM, DROM */
 
@@ -84,6 +84,7 @@ FLASH_BANK_COMMAND_HANDLER(esp32_flash_bank_command)
 	int ret = esp_xtensa_flash_init(&esp32_info->esp_xtensa,
 		ESP32_FLASH_SECTOR_SIZE,
 		xtensa_mcore_run_func_image,
+		xtensa_mcore_algo_resident_release,
 		esp32_is_irom_address,
 		esp32_is_drom_address,
 		esp32_get_stub);
@@ -107,6 +107,7 @@ FLASH_BANK_COMMAND_HANDLER(esp32_s2_flash_bank_command)
 	int ret = esp_xtensa_flash_init(&esp32_s2_info->esp_xtensa,
 		ESP32_S2_FLASH_SECTOR_SIZE,
 		xtensa_run_func_image,
+		xtensa_algo_resident_release,
 		esp32_s2_is_irom_address,
 		esp32_s2_is_drom_address,
 		esp32_s2_get_stub);
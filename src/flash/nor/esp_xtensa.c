@@ -61,6 +61,17 @@
  * requires halting the CPUs every time the host needs to check if there are incoming data or free space available
  * in the buffer. This fact can slow down flash write/read operations dramatically. To avoid this flash driver and
  * stub use application level tracing module API to transfer the data in 'non-stop' mode.
+ * Apptrace uses two TRAX memory blocks which are swapped by the target, so when host has written/read one of them
+ * the other one is usually ready. Because of that host polls the next block immediately and backs off only
+ * when stub is still busy with the previous one.
+ *
+ * Skipping Unchanged Sectors
+ * --------------------------
+ * When 'esp skip_unchanged' is on flash write requests CRC32 of every affected sector from the stub and compares
+ * them with CRC32 of the data to be written. Only sectors which differ are erased and written, so flash write
+ * erases sectors itself in this mode. Parts of the first and last sectors which are not covered by the write
+ * are read back before erasing and written again. CRC32 algorithm is the same as used by
+ * image_calculate_checksum().
  *
  */
 
@@ -79,6 +90,8 @@
 #define ESP_XTENSA_FLASH_MIN_OFFSET      0x1000	/* protect secure boot digest data */
 #define ESP_XTENSA_RW_TMO                20000	/* ms */
 #define ESP_XTENSA_ERASE_TMO             60000	/* ms */
+#define ESP_XTENSA_RW_BUSY_SPIN_NUM      4	/* busy polls w/o sleeping */
+#define ESP_XTENSA_RW_BUSY_SLEEP_MAX     8	/* ms */
 
 struct esp_xtensa_rw_args {
 	int (*xfer)(struct target *target, uint32_t block_id, uint32_t len, void *priv);
@@ -152,6 +165,7 @@ static int esp_xtensa_flasher_image_init(struct xtensa_algo_image *flasher_image
 int esp_xtensa_flash_init(struct esp_xtensa_flash_bank *esp_xtensa_info, uint32_t sec_sz,
 	int (*run_func_image)(struct target *target, struct xtensa_algo_run_data *run,
 		struct xtensa_algo_image *image, uint32_t num_args, ...),
+	void (*release_resident_stub)(struct target *target),
 	bool (*is_irom_address)(target_addr_t addr),
 	bool (*is_drom_address)(target_addr_t addr),
 	const struct esp_xtensa_flasher_stub_config *(*get_stub)(struct flash_bank *bank))
@@ -161,10 +175,14 @@ int esp_xtensa_flash_init(struct esp_xtensa_flash_bank *esp_xtensa_info, uint32_
 	esp_xtensa_info->sec_sz = sec_sz;
 	esp_xtensa_info->get_stub = get_stub;
 	esp_xtensa_info->run_func_image = run_func_image;
+	esp_xtensa_info->release_resident_stub = release_resident_stub;
 	esp_xtensa_info->is_irom_address = is_irom_address;
 	esp_xtensa_info->is_drom_address = is_drom_address;
 	esp_xtensa_info->hw_flash_base = 0;
 	esp_xtensa_info->appimage_flash_base = (uint32_t)-1;
+	esp_xtensa_info->skip_unchanged = false;
+	esp_xtensa_info->hash_unsupported = false;
+	esp_xtensa_info->stub_resident = false;
 	return ERROR_OK;
 }
 
@@ -195,6 +213,7 @@ int esp_xtensa_blank_check(struct flash_bank *bank)
 
 	memset(&run, 0, sizeof(run));
 	run.stack_size = 1300;
+	run.stub_resident = esp_xtensa_info->stub_resident;
 	struct mem_param mp;
 	init_mem_param(&mp, 3 /*3rd usr arg*/, bank->num_sectors /*size in bytes*/, PARAM_IN);
 	run.mem_args.params = &mp;
@@ -237,6 +256,7 @@ static uint32_t esp_xtensa_get_size(struct flash_bank *bank)
 
 	memset(&run, 0, sizeof(run));
 	run.stack_size = 1024;
+	run.stub_resident = esp_xtensa_info->stub_resident;
 	ret = esp_xtensa_info->run_func_image(bank->target,
 		&run,
 		&flasher_image,
@@ -267,6 +287,7 @@ static int esp_xtensa_get_mappings(struct flash_bank *bank,
 
 	memset(&run, 0, sizeof(run));
 	run.stack_size = 1300;
+	run.stub_resident = esp_xtensa_info->stub_resident;
 
 	struct mem_param mp;
 	init_mem_param(&mp,
@@ -329,6 +350,7 @@ int esp_xtensa_erase(struct flash_bank *bank, int first, int last)
 
 	memset(&run, 0, sizeof(run));
 	run.stack_size = 1024;
+	run.stub_resident = esp_xtensa_info->stub_resident;
 	run.tmo = ESP_XTENSA_ERASE_TMO;
 	ret = esp_xtensa_info->run_func_image(bank->target,
 		&run,
@@ -355,6 +377,7 @@ static int esp_xtensa_rw_do(struct target *target, void *priv)
 	struct duration algo_time, tmo_time;
 	struct esp_xtensa_rw_args *rw = (struct esp_xtensa_rw_args *)priv;
 	int retval = ERROR_OK, busy_num = 0;
+	uint32_t blocks_num = 0, busy_total = 0, busy_sleep = 0;
 
 	if (duration_start(&algo_time) != 0) {
 		LOG_ERROR("Failed to start data write time measurement!");
@@ -373,6 +396,7 @@ static int esp_xtensa_rw_do(struct target *target, void *priv)
 		retval = rw->xfer(target, block_id, len, rw);
 		if (retval == ERROR_WAIT) {
 			LOG_DEBUG("Block not ready");
+			busy_total++;
 			if (busy_num++ == 0) {
 				if (duration_start(&tmo_time) != 0) {
 					LOG_ERROR("Failed to start data write time measurement!");
@@ -389,12 +413,23 @@ static int esp_xtensa_rw_do(struct target *target, void *priv)
 					return ERROR_WAIT;
 				}
 			}
+			/* stub is busy with the previous block, poll it again right away for a few
+			 * times and then back off exponentially */
+			if (busy_num > ESP_XTENSA_RW_BUSY_SPIN_NUM) {
+				busy_sleep = busy_sleep ? MIN(2 * busy_sleep, ESP_XTENSA_RW_BUSY_SLEEP_MAX) : 1;
+				alive_sleep(busy_sleep);
+			} else
+				keep_alive();
 		} else if (retval != ERROR_OK) {
 			LOG_ERROR("Failed to transfer flash data block (%d)!", retval);
 			return retval;
-		} else
+		} else {
+			/* the other TRAX block is free now, so go on with the next one immediately */
 			busy_num = 0;
-		alive_sleep(10);
+			busy_sleep = 0;
+			blocks_num++;
+			keep_alive();
+		}
 		if (target->state != TARGET_DEBUG_RUNNING) {
 			LOG_ERROR("Algorithm accidentally stopped (%d)!", target->state);
 			return ERROR_FAIL;
@@ -404,9 +439,11 @@ static int esp_xtensa_rw_do(struct target *target, void *priv)
 		LOG_ERROR("Failed to stop data write measurement!");
 		return ERROR_FAIL;
 	}
-	LOG_DEBUG("PROF: Data transffered in %g ms @ %g KB/s",
+	LOG_DEBUG("PROF: Data transferred in %g ms @ %g KB/s (%d blocks, %d busy polls)",
 		duration_elapsed(&algo_time)*1000,
-		duration_kbps(&algo_time, rw->total_count));
+		duration_kbps(&algo_time, rw->total_count),
+		blocks_num,
+		busy_total);
 
 	return ERROR_OK;
 }
@@ -521,7 +558,7 @@ static void esp_xtensa_write_state_cleanup(struct target *target,
 	LOG_DEBUG("PROF: Workarea freed in %g ms", duration_elapsed(&algo_time)*1000);
 }
 
-int esp_xtensa_write(struct flash_bank *bank, const uint8_t *buffer,
+static int esp_xtensa_write_do(struct flash_bank *bank, const uint8_t *buffer,
 	uint32_t offset, uint32_t count)
 {
 	struct esp_xtensa_flash_bank *esp_xtensa_info = bank->driver_priv;
@@ -548,6 +585,7 @@ int esp_xtensa_write(struct flash_bank *bank, const uint8_t *buffer,
 
 	memset(&run, 0, sizeof(run));
 	run.stack_size = 1024;
+	run.stub_resident = esp_xtensa_info->stub_resident;
 	run.usr_func = esp_xtensa_rw_do;
 	run.usr_func_arg = &wr_state;
 	run.usr_func_init = (xtensa_algo_usr_func_init_t)esp_xtensa_write_state_init;
@@ -583,6 +621,185 @@ int esp_xtensa_write(struct flash_bank *bank, const uint8_t *buffer,
 	return ret;
 }
 
+static int esp_xtensa_calc_hash(struct flash_bank *bank, uint32_t offset, uint32_t count,
+	uint32_t *hashes, uint32_t hashes_num)
+{
+	struct esp_xtensa_flash_bank *esp_xtensa_info = bank->driver_priv;
+	struct xtensa_algo_run_data run;
+	struct xtensa_algo_image flasher_image;
+	struct duration hash_time;
+
+	if (duration_start(&hash_time) != 0) {
+		LOG_ERROR("Failed to start hash time measurement!");
+		return ERROR_FAIL;
+	}
+	int ret = esp_xtensa_flasher_image_init(&flasher_image, esp_xtensa_info->get_stub(bank));
+	if (ret != ERROR_OK)
+		return ret;
+
+	memset(&run, 0, sizeof(run));
+	run.stack_size = 1300;
+	run.stub_resident = esp_xtensa_info->stub_resident;
+	run.tmo = ESP_XTENSA_ERASE_TMO;
+	struct mem_param mp;
+	init_mem_param(&mp, 3 /*3rd usr arg*/, hashes_num * sizeof(uint32_t) /*size in bytes*/,
+		PARAM_IN);
+	run.mem_args.params = &mp;
+	run.mem_args.count = 1;
+
+	ret = esp_xtensa_info->run_func_image(bank->target,
+		&run,
+		&flasher_image,
+		4,
+		ESP_XTENSA_STUB_CMD_FLASH_CALC_HASH /*cmd*/,
+		esp_xtensa_info->hw_flash_base + offset /*start addr*/,
+		count /*size*/,
+		0 /*address to store hashes*/);
+	if (ret != ERROR_OK) {
+		LOG_ERROR("Failed to run flasher stub (%d)!", ret);
+		destroy_mem_param(&mp);
+		return ret;
+	}
+	if (run.ret_code == ESP_XTENSA_STUB_ERR_NOT_SUPPORTED) {
+		/* do not run stub for hashes anymore */
+		LOG_INFO("Flasher stub does not support hash calculation, all sectors will be written!");
+		esp_xtensa_info->hash_unsupported = true;
+		ret = ERROR_FAIL;
+	} else if (run.ret_code != ESP_XTENSA_STUB_ERR_OK) {
+		LOG_ERROR("Failed to calc flash hash (%d)!", run.ret_code);
+		ret = ERROR_FAIL;
+	} else {
+		for (uint32_t i = 0; i < hashes_num; i++)
+			hashes[i] = target_buffer_get_u32(bank->target, &mp.value[i * sizeof(uint32_t)]);
+	}
+	destroy_mem_param(&mp);
+	if (ret == ERROR_OK && duration_measure(&hash_time) == 0)
+		LOG_DEBUG("PROF: Hashed %d bytes in %g ms", count, duration_elapsed(&hash_time)*1000);
+	return ret;
+}
+
+/* Erases sectors from 'first' to 'last' and writes data to them. Parts of the edge sectors
+ * which are not covered by the data are read back and written again. */
+static int esp_xtensa_erase_write(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t offset, uint32_t count, uint32_t first, uint32_t last)
+{
+	struct esp_xtensa_flash_bank *esp_xtensa_info = bank->driver_priv;
+	uint32_t start = first * esp_xtensa_info->sec_sz;
+	uint32_t end = MIN((last + 1) * esp_xtensa_info->sec_sz, bank->size);
+	uint32_t last_start = last * esp_xtensa_info->sec_sz;
+	int ret;
+
+	if (offset == start && offset + count == end) {
+		ret = esp_xtensa_erase(bank, first, last);
+		if (ret != ERROR_OK)
+			return ret;
+		return esp_xtensa_write_do(bank, buffer, offset, count);
+	}
+
+	uint8_t *sec_buf = malloc(end - start);
+	if (sec_buf == NULL) {
+		LOG_ERROR("Failed to alloc mem for sectors data!");
+		return ERROR_FAIL;
+	}
+	ret = ERROR_OK;
+	if (offset > start)
+		ret = esp_xtensa_read(bank, sec_buf, start, MIN(esp_xtensa_info->sec_sz, end - start));
+	if (ret == ERROR_OK && offset + count < end && (first != last || offset == start))
+		ret = esp_xtensa_read(bank, sec_buf + (last_start - start), last_start, end - last_start);
+	if (ret != ERROR_OK) {
+		LOG_ERROR("Failed to read sectors %u..%u to preserve their contents!", first, last);
+		free(sec_buf);
+		return ret;
+	}
+	memcpy(sec_buf + (offset - start), buffer, count);
+	ret = esp_xtensa_erase(bank, first, last);
+	if (ret == ERROR_OK)
+		ret = esp_xtensa_write_do(bank, sec_buf, start, end - start);
+	free(sec_buf);
+	return ret;
+}
+
+/* Erases and writes only sectors whose contents differ from the data to be written */
+static int esp_xtensa_write_changed(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t offset, uint32_t count)
+{
+	struct esp_xtensa_flash_bank *esp_xtensa_info = bank->driver_priv;
+	uint32_t first = offset / esp_xtensa_info->sec_sz;
+	uint32_t last = (offset + count - 1) / esp_xtensa_info->sec_sz;
+	uint32_t sec_num = last - first + 1;
+	uint32_t changed_num = 0;
+
+	uint32_t *hashes = malloc(sec_num * sizeof(uint32_t));
+	bool *changed = malloc(sec_num * sizeof(bool));
+	if (hashes == NULL || changed == NULL) {
+		LOG_ERROR("Failed to alloc mem for sector hashes!");
+		free(hashes);
+		free(changed);
+		return ERROR_FAIL;
+	}
+
+	int ret = ERROR_FAIL;
+	if (!esp_xtensa_info->hash_unsupported)
+		ret = esp_xtensa_calc_hash(bank, offset, count, hashes, sec_num);
+	for (uint32_t i = 0; i < sec_num; i++) {
+		/* compare only the part of sector which is going to be written */
+		uint32_t chunk_start = MAX(offset, (first + i) * esp_xtensa_info->sec_sz);
+		uint32_t chunk_end = MIN(offset + count, (first + i + 1) * esp_xtensa_info->sec_sz);
+		uint32_t crc = 0;
+		changed[i] = true;
+		if (ret == ERROR_OK) {
+			image_calculate_checksum((uint8_t *)buffer + (chunk_start - offset),
+				chunk_end - chunk_start,
+				&crc);
+			changed[i] = crc != hashes[i];
+		}
+		if (changed[i])
+			changed_num++;
+	}
+	free(hashes);
+	LOG_INFO("%d of %d sectors changed @ 0x%x", changed_num, sec_num, offset);
+	esp_xtensa_info->changed_num = changed_num;
+	esp_xtensa_info->checked_num = sec_num;
+
+	ret = ERROR_OK;
+	for (uint32_t i = 0; i < sec_num && ret == ERROR_OK; ) {
+		if (!changed[i]) {
+			i++;
+			continue;
+		}
+		/* erase and write range of adjacent changed sectors at once */
+		uint32_t k = i;
+		while (k + 1 < sec_num && changed[k + 1])
+			k++;
+		uint32_t chunk_start = MAX(offset, (first + i) * esp_xtensa_info->sec_sz);
+		uint32_t chunk_end = MIN(offset + count, (first + k + 1) * esp_xtensa_info->sec_sz);
+		ret = esp_xtensa_erase_write(bank,
+			buffer + (chunk_start - offset),
+			chunk_start,
+			chunk_end - chunk_start,
+			first + i,
+			first + k);
+		i = k + 1;
+	}
+	free(changed);
+	return ret;
+}
+
+int esp_xtensa_write(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t offset, uint32_t count)
+{
+	struct esp_xtensa_flash_bank *esp_xtensa_info = bank->driver_priv;
+
+	if (esp_xtensa_info->skip_unchanged && count > 0) {
+		if (bank->target->state != TARGET_HALTED) {
+			LOG_ERROR("Target not halted");
+			return ERROR_TARGET_NOT_HALTED;
+		}
+		return esp_xtensa_write_changed(bank, buffer, offset, count);
+	}
+	return esp_xtensa_write_do(bank, buffer, offset, count);
+}
+
 static int esp_xtensa_read_xfer(struct target *target, uint32_t block_id, uint32_t len, void *priv)
 {
 	struct esp_xtensa_read_state *state = (struct esp_xtensa_read_state *)priv;
@@ -672,6 +889,7 @@ int esp_xtensa_read(struct flash_bank *bank, uint8_t *buffer,
 
 	memset(&run, 0, sizeof(run));
 	run.stack_size = 1024;
+	run.stub_resident = esp_xtensa_info->stub_resident;
 	run.usr_func_init = (xtensa_algo_usr_func_init_t)esp_xtensa_read_state_init;
 	run.usr_func = esp_xtensa_rw_do;
 	run.usr_func_arg = &rd_state;
@@ -875,6 +1093,7 @@ int esp_xtensa_flash_breakpoint_add(struct target *target,
 	LOG_DEBUG("SEC_SIZE %d", esp_xtensa_info->sec_sz);
 	memset(&run, 0, sizeof(run));
 	run.stack_size = 1300;
+	run.stub_resident = esp_xtensa_info->stub_resident;
 	run.usr_func_arg = &op_state;
 	run.usr_func_init = (xtensa_algo_usr_func_init_t)esp_xtensa_flash_bp_op_state_init;
 	run.usr_func_done = (xtensa_algo_usr_func_done_t)esp_xtensa_flash_bp_op_state_cleanup;
@@ -943,6 +1162,7 @@ int esp_xtensa_flash_breakpoint_remove(struct target *target,
 	op_state.esp_xtensa_info = esp_xtensa_info;
 	memset(&run, 0, sizeof(run));
 	run.stack_size = 1300;
+	run.stub_resident = esp_xtensa_info->stub_resident;
 	run.usr_func_arg = &op_state;
 	run.usr_func_init = (xtensa_algo_usr_func_init_t)esp_xtensa_flash_bp_op_state_init;
 	run.usr_func_done = (xtensa_algo_usr_func_done_t)esp_xtensa_flash_bp_op_state_cleanup;
@@ -985,12 +1205,11 @@ int esp_xtensa_flash_breakpoint_remove(struct target *target,
 	return ret;
 }
 
-static int esp_xtensa_appimage_flash_base_update(struct target *target,
+static int esp_xtensa_flash_bank_get(struct target *target,
 	char *bank_name_suffix,
-	uint32_t appimage_flash_base)
+	bool probe,
+	struct flash_bank **bank)
 {
-	struct flash_bank *bank;
-	struct esp_xtensa_flash_bank *esp_xtensa_info;
 	char bank_name[64];
 
 	int ret = snprintf(bank_name,
@@ -1002,7 +1221,27 @@ static int esp_xtensa_appimage_flash_base_update(struct target *target,
 		LOG_ERROR("Failed to build bank name string!");
 		return ERROR_FAIL;
 	}
-	ret = get_flash_bank_by_name(bank_name, &bank);
+	if (probe) {
+		ret = get_flash_bank_by_name(bank_name, bank);
+		if (ret != ERROR_OK)
+			return ret;
+	} else
+		*bank = get_flash_bank_by_name_noprobe(bank_name);
+	if (*bank == NULL) {
+		LOG_ERROR("Flash bank '%s' not found!", bank_name);
+		return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
+
+static int esp_xtensa_appimage_flash_base_update(struct target *target,
+	char *bank_name_suffix,
+	uint32_t appimage_flash_base)
+{
+	struct flash_bank *bank;
+	struct esp_xtensa_flash_bank *esp_xtensa_info;
+
+	int ret = esp_xtensa_flash_bank_get(target, bank_name_suffix, true, &bank);
 	if (ret != ERROR_OK)
 		return ret;
 	esp_xtensa_info = (struct esp_xtensa_flash_bank *)bank->driver_priv;
@@ -1035,6 +1274,80 @@ COMMAND_HANDLER(esp_xtensa_cmd_appimage_flashoff)
 	return ERROR_OK;
 }
 
+/* Applies setter to all flash banks of the target: HW flash bank and IROM/DROM fake banks */
+static int esp_xtensa_flash_banks_set(struct target *target,
+	void (*setter)(struct esp_xtensa_flash_bank *esp_xtensa_info, bool val),
+	bool val)
+{
+	char *banks[] = {"flash", "irom", "drom"};
+
+	for (size_t i = 0; i < sizeof(banks)/sizeof(banks[0]); i++) {
+		struct flash_bank *bank;
+		int ret = esp_xtensa_flash_bank_get(target, banks[i], false, &bank);
+		if (ret != ERROR_OK)
+			return ret;
+		setter(bank->driver_priv, val);
+	}
+	return ERROR_OK;
+}
+
+static void esp_xtensa_skip_unchanged_set(struct esp_xtensa_flash_bank *esp_xtensa_info, bool val)
+{
+	esp_xtensa_info->skip_unchanged = val;
+}
+
+static void esp_xtensa_stub_resident_set(struct esp_xtensa_flash_bank *esp_xtensa_info, bool val)
+{
+	esp_xtensa_info->stub_resident = val;
+}
+
+COMMAND_HANDLER(esp_xtensa_cmd_skip_unchanged)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	bool skip_unchanged;
+
+	if (CMD_ARGC == 0) {
+		struct flash_bank *bank;
+		int ret = esp_xtensa_flash_bank_get(target, "flash", false, &bank);
+		if (ret != ERROR_OK)
+			return ret;
+		struct esp_xtensa_flash_bank *esp_xtensa_info = bank->driver_priv;
+		command_print(CMD, "skip_unchanged: %s, last write: %u of %u sectors changed%s",
+			esp_xtensa_info->skip_unchanged ? "on" : "off",
+			esp_xtensa_info->changed_num,
+			esp_xtensa_info->checked_num,
+			esp_xtensa_info->hash_unsupported ? ", hashing is not supported by stub" : "");
+		return ERROR_OK;
+	}
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	COMMAND_PARSE_ON_OFF(CMD_ARGV[0], skip_unchanged);
+	return esp_xtensa_flash_banks_set(target, esp_xtensa_skip_unchanged_set, skip_unchanged);
+}
+
+COMMAND_HANDLER(esp_xtensa_cmd_stub_resident)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct flash_bank *bank;
+	bool stub_resident;
+
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	COMMAND_PARSE_ON_OFF(CMD_ARGV[0], stub_resident);
+	int ret = esp_xtensa_flash_banks_set(target, esp_xtensa_stub_resident_set, stub_resident);
+	if (ret != ERROR_OK)
+		return ret;
+	/* all banks share the same target */
+	if (!stub_resident && target->state == TARGET_HALTED) {
+		ret = esp_xtensa_flash_bank_get(target, "flash", false, &bank);
+		if (ret != ERROR_OK)
+			return ret;
+		struct esp_xtensa_flash_bank *esp_xtensa_info = bank->driver_priv;
+		esp_xtensa_info->release_resident_stub(target);
+	}
+	return ERROR_OK;
+}
+
 const struct command_registration esp_xtensa_exec_command_handlers[] = {
 	{
 		.name = "appimage_offset",
@@ -1044,5 +1357,22 @@ const struct command_registration esp_xtensa_exec_command_handlers[] = {
 			"Set offset of application image in flash. Use -1 to debug the first application image from partition table.",
 		.usage = "offset",
 	},
+	{
+		.name = "skip_unchanged",
+		.handler = esp_xtensa_cmd_skip_unchanged,
+		.mode = COMMAND_ANY,
+		.help =
+			"Enable/disable skipping of unchanged sectors. When enabled flash write erases changed sectors itself. "
+			"Without arguments shows the state and the number of sectors changed by the last write.",
+		.usage = "['on'|'off']",
+	},
+	{
+		.name = "stub_resident",
+		.handler = esp_xtensa_cmd_stub_resident,
+		.mode = COMMAND_ANY,
+		.help =
+			"Keep flasher stub loaded on target between flash operations until target is resumed or reset.",
+		.usage = "['on'|'off']",
+	},
 	COMMAND_REGISTRATION_DONE
 };
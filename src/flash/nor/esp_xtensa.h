@@ -42,10 +42,21 @@ struct esp_xtensa_flash_bank {
 	uint32_t hw_flash_base;
 	/* Offset of the application image in the HW flash bank */
 	uint32_t appimage_flash_base;
+	/* Write erases changed sectors itself and skips unchanged ones */
+	bool skip_unchanged;
+	/* Stub can not calculate sector hashes, so all sectors are written when skip_unchanged is on */
+	bool hash_unsupported;
+	/* Number of sectors written and checked by the last write with skip_unchanged on */
+	uint32_t changed_num;
+	uint32_t checked_num;
+	/* Keep flasher stub loaded on target between flash operations */
+	bool stub_resident;
 	const struct esp_xtensa_flasher_stub_config *(*get_stub)(struct flash_bank *bank);
 	/* function to run algorithm on Xtensa target */
 	int (*run_func_image)(struct target *target, struct xtensa_algo_run_data *run,
 		struct xtensa_algo_image *image, uint32_t num_args, ...);
+	/* function to unload resident stub from Xtensa target */
+	void (*release_resident_stub)(struct target *target);
 	bool (*is_irom_address)(target_addr_t addr);
 	bool (*is_drom_address)(target_addr_t addr);
 };
@@ -64,6 +75,7 @@ extern const struct command_registration esp_xtensa_exec_command_handlers[];
 int esp_xtensa_flash_init(struct esp_xtensa_flash_bank *esp_xtensa_info, uint32_t sec_sz,
 	int (*run_func_image)(struct target *target, struct xtensa_algo_run_data *run,
 		struct xtensa_algo_image *image, uint32_t num_args, ...),
+	void (*release_resident_stub)(struct target *target),
 	bool (*is_irom_address)(target_addr_t addr),
 	bool (*is_drom_address)(target_addr_t addr),
 	const struct esp_xtensa_flasher_stub_config *(*get_stub)(struct flash_bank *bank));
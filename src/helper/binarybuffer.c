@@ -45,10 +45,24 @@ static const unsigned char bit_reverse_table256[] = {
 	0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF, 0x1F, 0x9F, 0x5F, 0xDF, 0x3F, 0xBF, 0x7F, 0xFF
 };
 
-static const char hex_digits[] = {
-	'0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
-	'a', 'b', 'c', 'd', 'e', 'f'
-};
+/* two hex digits for every byte value, see hexify() */
+static const char hex_byte_digits[] =
+	"000102030405060708090a0b0c0d0e0f"
+	"101112131415161718191a1b1c1d1e1f"
+	"202122232425262728292a2b2c2d2e2f"
+	"303132333435363738393a3b3c3d3e3f"
+	"404142434445464748494a4b4c4d4e4f"
+	"505152535455565758595a5b5c5d5e5f"
+	"606162636465666768696a6b6c6d6e6f"
+	"707172737475767778797a7b7c7d7e7f"
+	"808182838485868788898a8b8c8d8e8f"
+	"909192939495969798999a9b9c9d9e9f"
+	"a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+	"b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+	"c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+	"d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+	"e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+	"f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
 
 void *buf_cpy(const void *from, void *_to, unsigned size)
 {
@@ -427,14 +441,22 @@ size_t unhexify(uint8_t *bin, const char *hex, size_t count)
 size_t hexify(char *hex, const uint8_t *bin, size_t count, size_t length)
 {
 	size_t i;
-	uint8_t tmp;
 
 	if (!length)
 		return 0;
 
-	for (i = 0; i < length - 1 && i < 2 * count; i++) {
-		tmp = (bin[i / 2] >> (4 * ((i + 1) % 2))) & 0x0f;
-		hex[i] = hex_digits[tmp];
+	size_t n = MIN(length - 1, 2 * count);
+	/* both digits of the byte are fetched at once. Byte is read before its digits are
+	 * written, so it is safe to encode data placed at the tail of the 'hex' buffer */
+	for (i = 0; i + 1 < n; i += 2) {
+		const char *digits = &hex_byte_digits[2 * bin[i / 2]];
+		hex[i] = digits[0];
+		hex[i + 1] = digits[1];
+	}
+	if (i < n) {
+		/* output is truncated in the middle of byte */
+		hex[i] = hex_byte_digits[2 * bin[i / 2]];
+		i++;
 	}
 
 	hex[i] = 0;
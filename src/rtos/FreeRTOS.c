@@ -38,12 +38,37 @@
 
 #define FREERTOS_MAX_PRIORITIES	63
 #define FREERTOS_MAX_TASKS_NUM	512
+#define FREERTOS_THREAD_NAME_STR_SIZE (200)
+/* Stack area read in advance around the top of thread's stack, covers all known stackings */
+#define FREERTOS_STACK_PREFETCH_BELOW	0x10
+#define FREERTOS_STACK_PREFETCH_ABOVE	0x100
+/* Max size of list item's part from next pointer to owner inclusively */
+#define FREERTOS_LIST_ELEM_READ_MAX	16
 
 #define FreeRTOS_STRUCT(int_type, ptr_type, list_prev_offset)
 
+struct FreeRTOS_thread_name {
+	int64_t threadid;
+	char *name;
+};
+
+struct FreeRTOS_list_elem {
+	int64_t address;
+	int64_t owner;
+};
+
 struct FreeRTOS_data
 {
 	unsigned int* core_interruptNesting;
+	/* Names of the tasks seen during previous updates. TCB memory can be reused by another task
+	 * only when new task is created, so cached names are valid while uxTaskNumber is unchanged. */
+	struct FreeRTOS_thread_name *names;
+	int names_num;
+	/* State list items of the same tasks and TCBs owning them. Item is embedded into TCB,
+	 * so only its next pointer needs to be re-read while the cache is valid. */
+	struct FreeRTOS_list_elem *elems;
+	int elems_num;
+	uint32_t task_number;
 };
 struct FreeRTOS_params {
 	const char *target_name;
@@ -177,6 +202,7 @@ enum FreeRTOS_symbol_values {
 	FreeRTOS_VAL_uxCurrentNumberOfTasks = 9,
 	FreeRTOS_VAL_uxTopUsedPriority = 10,
 	FreeRTOS_VAL_port_interruptNesting = 11,
+	FreeRTOS_VAL_uxTaskNumber = 12,
 };
 
 struct symbols {
@@ -197,9 +223,134 @@ static const struct symbols FreeRTOS_symbol_list[] = {
 	{ "uxCurrentNumberOfTasks", false },
 	{ "uxTopUsedPriority", true }, /* Unavailable since v7.5.3 */
 	{ "port_interruptNesting", true },
+	{ "uxTaskNumber", true }, /* Allows to cache task names */
 	{ NULL, false }
 };
 
+static uint64_t FreeRTOS_buf_get(const uint8_t *buf, unsigned int width)
+{
+	uint64_t val = 0;
+	memcpy(&val, buf, width);
+	return val;
+}
+
+static void FreeRTOS_tasks_cache_clear(struct FreeRTOS_data *rtos_data)
+{
+	for (int i = 0; i < rtos_data->names_num; i++)
+		free(rtos_data->names[i].name);
+	free(rtos_data->names);
+	rtos_data->names = NULL;
+	rtos_data->names_num = 0;
+	free(rtos_data->elems);
+	rtos_data->elems = NULL;
+	rtos_data->elems_num = 0;
+}
+
+/* Returns allocated copy of the task name, reads it from target only if it is not cached */
+static char *FreeRTOS_get_thread_name(struct rtos *rtos, int64_t threadid)
+{
+	const struct FreeRTOS_params *param = (const struct FreeRTOS_params *) rtos->rtos_specific_params;
+	struct FreeRTOS_data *rtos_data = (struct FreeRTOS_data *) rtos->rtos_specific_data;
+	char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
+
+	for (int i = 0; i < rtos_data->names_num; i++) {
+		if (rtos_data->names[i].threadid == threadid)
+			return strdup(rtos_data->names[i].name);
+	}
+
+	/* Read the thread name */
+	int retval = target_read_buffer(rtos->target,
+			threadid + param->thread_name_offset,
+			FREERTOS_THREAD_NAME_STR_SIZE,
+			(uint8_t *)&tmp_str);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading FreeRTOS thread name");
+		return NULL;
+	}
+	tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
+	LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value \"%s\"",
+										threadid + param->thread_name_offset,
+										tmp_str);
+
+	if (tmp_str[0] == '\x00')
+		strcpy(tmp_str, "No Name");
+
+	struct FreeRTOS_thread_name *names = realloc(rtos_data->names,
+			(rtos_data->names_num + 1) * sizeof(struct FreeRTOS_thread_name));
+	if (names) {
+		rtos_data->names = names;
+		names[rtos_data->names_num].name = strdup(tmp_str);
+		if (names[rtos_data->names_num].name) {
+			names[rtos_data->names_num].threadid = threadid;
+			rtos_data->names_num++;
+		}
+	}
+	return strdup(tmp_str);
+}
+
+/* Reads next pointers of all cached list items at once */
+static void FreeRTOS_prefetch_list_elems(struct rtos *rtos)
+{
+	const struct FreeRTOS_params *param = (const struct FreeRTOS_params *) rtos->rtos_specific_params;
+	struct FreeRTOS_data *rtos_data = (struct FreeRTOS_data *) rtos->rtos_specific_data;
+
+	if (rtos_data->elems_num == 0)
+		return;
+	struct rtos_mem_range *ranges = calloc(rtos_data->elems_num, sizeof(*ranges));
+	if (!ranges)
+		return;
+	for (int i = 0; i < rtos_data->elems_num; i++) {
+		ranges[i].address = rtos_data->elems[i].address + param->list_elem_next_offset;
+		ranges[i].size = param->pointer_width;
+	}
+	rtos_prefetch(rtos, ranges, rtos_data->elems_num);
+	free(ranges);
+}
+
+/* Gets the next list item and the owner of the item, reads the owner from target only if it is not cached */
+static int FreeRTOS_read_list_elem(struct rtos *rtos, int64_t elem_ptr, int64_t *next, int64_t *owner)
+{
+	const struct FreeRTOS_params *param = (const struct FreeRTOS_params *) rtos->rtos_specific_params;
+	struct FreeRTOS_data *rtos_data = (struct FreeRTOS_data *) rtos->rtos_specific_data;
+	uint8_t elem_buf[FREERTOS_LIST_ELEM_READ_MAX];
+	int retval;
+
+	for (int i = 0; i < rtos_data->elems_num; i++) {
+		if (rtos_data->elems[i].address == elem_ptr) {
+			retval = rtos_read_buffer(rtos->target,
+					elem_ptr + param->list_elem_next_offset,
+					param->pointer_width,
+					elem_buf);
+			if (retval != ERROR_OK)
+				return retval;
+			*next = FreeRTOS_buf_get(elem_buf, param->pointer_width);
+			*owner = rtos_data->elems[i].owner;
+			return ERROR_OK;
+		}
+	}
+
+	/* list item's next pointer and owner are read in one go */
+	retval = target_read_buffer(rtos->target,
+			elem_ptr + param->list_elem_next_offset,
+			param->list_elem_content_offset + param->pointer_width - param->list_elem_next_offset,
+			elem_buf);
+	if (retval != ERROR_OK)
+		return retval;
+	*next = FreeRTOS_buf_get(elem_buf, param->pointer_width);
+	*owner = FreeRTOS_buf_get(&elem_buf[param->list_elem_content_offset - param->list_elem_next_offset],
+			param->pointer_width);
+
+	struct FreeRTOS_list_elem *elems = realloc(rtos_data->elems,
+			(rtos_data->elems_num + 1) * sizeof(struct FreeRTOS_list_elem));
+	if (elems) {
+		rtos_data->elems = elems;
+		elems[rtos_data->elems_num].address = elem_ptr;
+		elems[rtos_data->elems_num].owner = *owner;
+		rtos_data->elems_num++;
+	}
+	return ERROR_OK;
+}
+
 /* TODO: */
 /* this is not safe for little endian yet */
 /* may be problems reading if sizes are not 32 bit long integers. */
@@ -251,6 +402,18 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 		return -2;
 	}
 
+	/* drop cached task names if any task has been created since the last update */
+	uint32_t task_number = 0;
+	if (rtos->symbols[FreeRTOS_VAL_uxTaskNumber].address == 0 ||
+		target_read_buffer(rtos->target,
+			rtos->symbols[FreeRTOS_VAL_uxTaskNumber].address,
+			param->thread_count_width,
+			(uint8_t *)&task_number) != ERROR_OK ||
+		task_number != rtos_data->task_number) {
+		FreeRTOS_tasks_cache_clear(rtos_data);
+		rtos_data->task_number = task_number;
+	}
+
 	int cores_count = target_get_core_count(rtos->target);
 	/* wipe out previous thread details if any */
 	rtos_free_threadlist(rtos);
@@ -355,18 +518,30 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 		return ERROR_FAIL;
 	}
 
-	symbol_address_t *list_of_lists =
-		malloc(sizeof(symbol_address_t) *
-			(max_used_priority+1 + 5));
-	if (!list_of_lists) {
+	/* ready lists are contiguous, read them all at once along with the other list headers */
+	int num_lists = max_used_priority + 1 + 5;
+	symbol_address_t *list_of_lists = malloc(sizeof(symbol_address_t) * num_lists);
+	uint8_t *list_hdrs = malloc(param->list_width * num_lists);
+	if (!list_of_lists || !list_hdrs) {
 		LOG_ERROR("Error allocating memory for %" PRId64 " priorities", max_used_priority);
+		free(list_of_lists);
+		free(list_hdrs);
 		return ERROR_FAIL;
 	}
 
-	int num_lists;
 	for (num_lists = 0; num_lists <= max_used_priority; num_lists++)
 		list_of_lists[num_lists] = rtos->symbols[FreeRTOS_VAL_pxReadyTasksLists].address +
 			num_lists * param->list_width;
+	retval = target_read_buffer(rtos->target,
+			list_of_lists[0],
+			param->list_width * num_lists,
+			list_hdrs);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading FreeRTOS ready lists");
+		free(list_of_lists);
+		free(list_hdrs);
+		return retval;
+	}
 
 	list_of_lists[num_lists++] = rtos->symbols[FreeRTOS_VAL_xDelayedTaskList1].address;
 	list_of_lists[num_lists++] = rtos->symbols[FreeRTOS_VAL_xDelayedTaskList2].address;
@@ -374,21 +549,37 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 	list_of_lists[num_lists++] = rtos->symbols[FreeRTOS_VAL_xSuspendedTaskList].address;
 	list_of_lists[num_lists++] = rtos->symbols[FreeRTOS_VAL_xTasksWaitingTermination].address;
 
+	if (param->list_elem_content_offset <= param->list_elem_next_offset ||
+		param->list_elem_content_offset + param->pointer_width - param->list_elem_next_offset > FREERTOS_LIST_ELEM_READ_MAX) {
+		LOG_ERROR("FreeRTOS: unsupported list item layout (next %u, owner %u)!",
+			param->list_elem_next_offset, param->list_elem_content_offset);
+		free(list_of_lists);
+		free(list_hdrs);
+		return ERROR_FAIL;
+	}
+	FreeRTOS_prefetch_list_elems(rtos);
+
 	for (i = 0; i < num_lists; i++) {
 		if (list_of_lists[i] == 0)
 			continue;
 
-		/* Read the number of threads in this list */
-		int64_t list_thread_count = 0;
-		retval = target_read_buffer(rtos->target,
-				list_of_lists[i],
-				param->thread_count_width,
-				(uint8_t *)&list_thread_count);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading number of threads in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
+		uint8_t *list_hdr = &list_hdrs[i * param->list_width];
+		if (i > max_used_priority) {
+			retval = target_read_buffer(rtos->target,
+					list_of_lists[i],
+					param->list_width,
+					list_hdr);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("Error reading FreeRTOS thread list");
+				rtos_prefetch_free(rtos);
+				free(list_of_lists);
+				free(list_hdrs);
+				return retval;
+			}
 		}
+
+		/* Read the number of threads in this list */
+		int64_t list_thread_count = FreeRTOS_buf_get(list_hdr, param->thread_count_width);
 		LOG_DEBUG("FreeRTOS: Read thread count for list %d at 0x%" PRIx64 ", value %" PRId64,
 										i, list_of_lists[i], list_thread_count);
 
@@ -397,31 +588,23 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 
 		/* Read the location of first list item */
 		uint64_t prev_list_elem_ptr = -1;
-		uint64_t list_elem_ptr = 0;
-		retval = target_read_buffer(rtos->target,
-				list_of_lists[i] + param->list_next_offset,
-				param->pointer_width,
-				(uint8_t *)&list_elem_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
-		}
+		uint64_t list_elem_ptr = FreeRTOS_buf_get(&list_hdr[param->list_next_offset],
+				param->pointer_width);
 		LOG_DEBUG("FreeRTOS: Read first item for list %d at 0x%" PRIx64 ", value 0x%" PRIx64,
 										i, list_of_lists[i] + param->list_next_offset, list_elem_ptr);
 
 		while ((list_thread_count > 0) && (list_elem_ptr != 0) &&
 				(list_elem_ptr != prev_list_elem_ptr) &&
 				(tasks_found < thread_list_size)) {
-			/* Get the location of the thread structure. */
-			rtos->thread_details[tasks_found].threadid = 0;
-			retval = target_read_buffer(rtos->target,
-					list_elem_ptr + param->list_elem_content_offset,
-					param->pointer_width,
-					(uint8_t *)&(rtos->thread_details[tasks_found].threadid));
+			/* Get the location of the thread structure and the next list item. */
+			int64_t next_elem_ptr = 0;
+			retval = FreeRTOS_read_list_elem(rtos, list_elem_ptr, &next_elem_ptr,
+					&rtos->thread_details[tasks_found].threadid);
 			if (retval != ERROR_OK) {
 				LOG_ERROR("Error reading thread list item object in FreeRTOS thread list");
+				rtos_prefetch_free(rtos);
 				free(list_of_lists);
+				free(list_hdrs);
 				return retval;
 			}
 			LOG_DEBUG("FreeRTOS: Read Thread ID at 0x%" PRIx64 ", value 0x%" PRIx64 " %i",
@@ -429,32 +612,14 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 										rtos->thread_details[tasks_found].threadid, (unsigned int) rtos->thread_details[tasks_found].threadid);
 
 			/* get thread name */
-
-
-			#define FREERTOS_THREAD_NAME_STR_SIZE (200)
-			char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
-
-			/* Read the thread name */
-			retval = target_read_buffer(rtos->target,
-					rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
-					FREERTOS_THREAD_NAME_STR_SIZE,
-					(uint8_t *)&tmp_str);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading FreeRTOS thread name");
+			rtos->thread_details[tasks_found].thread_name_str =
+				FreeRTOS_get_thread_name(rtos, rtos->thread_details[tasks_found].threadid);
+			if (!rtos->thread_details[tasks_found].thread_name_str) {
+				rtos_prefetch_free(rtos);
 				free(list_of_lists);
-				return retval;
+				free(list_hdrs);
+				return ERROR_FAIL;
 			}
-			tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
-			LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value \"%s\"",
-										rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
-										tmp_str);
-
-			if (tmp_str[0] == '\x00')
-				strcpy(tmp_str, "No Name");
-
-			rtos->thread_details[tasks_found].thread_name_str =
-				malloc(strlen(tmp_str)+1);
-			strcpy(rtos->thread_details[tasks_found].thread_name_str, tmp_str);
 			rtos->thread_details[tasks_found].exists = true;
 
 			int thread_running = 0;
@@ -477,21 +642,15 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 			list_thread_count--;
 
 			prev_list_elem_ptr = list_elem_ptr;
-			list_elem_ptr = 0;
-			retval = target_read_buffer(rtos->target,
-					prev_list_elem_ptr + param->list_elem_next_offset,
-					param->pointer_width,
-					(uint8_t *)&list_elem_ptr);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading next thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
-			}
+			list_elem_ptr = next_elem_ptr;
 			LOG_DEBUG("FreeRTOS: Read next thread location at 0x%" PRIx64 ", value 0x%" PRIx64,
 										prev_list_elem_ptr + param->list_elem_next_offset,
 										list_elem_ptr);
 		}
 	}
+	/* list items are not needed anymore, let stack frames be prefetched on demand */
+	rtos_prefetch_free(rtos);
+	free(list_hdrs);
 	free(list_of_lists);
 
 	for (i = 0; i < cores_count; i++)
@@ -510,29 +669,12 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 			return ERROR_FAIL;
 		}
 
-		#define FREERTOS_THREAD_NAME_STR_SIZE (200)
-		char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
-
-		/* Read the thread name */
-		retval = target_read_buffer(rtos->target,
-			rtos->core_running_threads[i] + param->thread_name_offset,
-			FREERTOS_THREAD_NAME_STR_SIZE,
-			(uint8_t *)&tmp_str);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error2 reading FreeRTOS thread name.");
-			return retval;
-		}
-
-		if (tmp_str[0] == '\x00')
-			strcpy(tmp_str, "No Name");
-
 		rtos->thread_details[tasks_found].thread_name_str =
-			malloc(strlen(tmp_str) + 1);
+			FreeRTOS_get_thread_name(rtos, rtos->core_running_threads[i]);
 		if (rtos->thread_details[tasks_found].thread_name_str == NULL) {
-			LOG_ERROR("Failed to alloc mem for thread name!");
+			LOG_ERROR("Failed to get thread name!");
 			return ERROR_FAIL;
 		}
-		strcpy(rtos->thread_details[tasks_found].thread_name_str, tmp_str);
 		rtos->thread_details[tasks_found].exists = true;
 		tasks_found++;
 	}
@@ -570,8 +712,16 @@ static int FreeRTOS_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 		}
 	}
 
+	/* Stacking pick function and stack readers read the stack pointer and parts of the frame
+	 * separately, so read them once for the requested thread */
+	struct rtos_mem_range range = {
+		.address = thread_id + param->thread_stack_offset,
+		.size = param->pointer_width,
+	};
+	rtos_prefetch(rtos, &range, 1);
+
 	/* Read the stack pointer */
-	retval = target_read_buffer(rtos->target,
+	retval = rtos_read_buffer(rtos->target,
 			thread_id + param->thread_stack_offset,
 			param->pointer_width,
 			(uint8_t *)&stack_ptr);
@@ -579,6 +729,11 @@ static int FreeRTOS_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 		LOG_ERROR("Error reading stack frame from FreeRTOS thread");
 		return retval;
 	}
+	if (stack_ptr != 0) {
+		range.address = stack_ptr - FREERTOS_STACK_PREFETCH_BELOW;
+		range.size = FREERTOS_STACK_PREFETCH_BELOW + FREERTOS_STACK_PREFETCH_ABOVE;
+		rtos_prefetch(rtos, &range, 1);
+	}
 	LOG_DEBUG("FreeRTOS: Read stack pointer at 0x%" PRIx64 ", value 0x%" PRIx64,
 										thread_id + param->thread_stack_offset,
 										stack_ptr);
@@ -659,7 +814,6 @@ static int FreeRTOS_get_thread_ascii_info(struct rtos *rtos, threadid_t thread_i
 
 	param = (const struct FreeRTOS_params *) rtos->rtos_specific_params;
 
-#define FREERTOS_THREAD_NAME_STR_SIZE (200)
 	char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
 
 	/* Read the thread name */
@@ -705,6 +859,8 @@ static int FreeRTOS_post_reset_cleanup(struct target *target)
 			LOG_ERROR("Failed clearing FreeRTOS_VAL_pxCurrentTCB");
 			return ret;
 		}
+		if (target->rtos->rtos_specific_data)
+			FreeRTOS_tasks_cache_clear(target->rtos->rtos_specific_data);
 		FreeRTOS_update_threads(target->rtos);
 	}
 	target->rtos->current_threadid = -1;
@@ -722,6 +878,11 @@ static int FreeRTOS_clean(struct target *target)
 		target->rtos->current_thread = 0;
 		free(target->rtos->core_running_threads);
 		target->rtos->core_running_threads = NULL;
+		struct FreeRTOS_data *rtos_data = target->rtos->rtos_specific_data;
+		if (rtos_data) {
+			FreeRTOS_tasks_cache_clear(rtos_data);
+			free(rtos_data->core_interruptNesting);
+		}
 		free(target->rtos->rtos_specific_data);
 		target->rtos->rtos_specific_data = NULL;
 	}
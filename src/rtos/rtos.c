@@ -27,6 +27,16 @@
 #include "helper/binarybuffer.h"
 #include "server/gdb_server.h"
 
+/* Ranges closer than this are merged and read with one request, the others are read separately */
+#define RTOS_PREFETCH_MAX_GAP		256
+#define RTOS_PREFETCH_MAX_REGION	(64*1024)
+
+struct rtos_prefetch_region {
+	int64_t address;
+	uint32_t size;
+	uint8_t *data;
+};
+
 /* RTOSs */
 extern struct rtos_type FreeRTOS_rtos;
 extern struct rtos_type ThreadX_rtos;
@@ -101,6 +111,7 @@ static void os_free(struct target *target)
 	if (target->rtos->symbols)
 		free(target->rtos->symbols);
 
+	rtos_prefetch_free(target->rtos);
 	free(target->rtos);
 	target->rtos = NULL;
 }
@@ -573,6 +584,120 @@ int rtos_set_reg(struct connection *connection, int reg_num,
 	return ERROR_FAIL;
 }
 
+static int rtos_mem_range_cmp(const void *a, const void *b)
+{
+	const struct rtos_mem_range *ra = a, *rb = b;
+	if (ra->address < rb->address)
+		return -1;
+	return ra->address > rb->address;
+}
+
+static struct rtos_prefetch_region *rtos_prefetch_find(struct rtos *rtos, int64_t address, uint32_t size)
+{
+	if (!rtos_prefetch_valid(rtos))
+		return NULL;
+	for (int i = 0; i < rtos->prefetched_num; i++) {
+		struct rtos_prefetch_region *region = &rtos->prefetched[i];
+		if (address >= region->address &&
+			address + size <= region->address + region->size)
+			return region;
+	}
+	return NULL;
+}
+
+/**
+ * Reads the given memory ranges in advance, so subsequent rtos_read_buffer() calls for them
+ * do not go to the target. Ranges which have already been read are skipped, close ranges are
+ * merged and read with a single request.
+ * Prefetched data are discarded when the target memory could have changed (e.g. on resume).
+ */
+int rtos_prefetch(struct rtos *rtos, const struct rtos_mem_range *ranges, int count)
+{
+	if (!rtos_prefetch_valid(rtos))
+		rtos_prefetch_free(rtos);
+	if (count == 0)
+		return ERROR_OK;
+
+	struct rtos_mem_range *sorted = malloc(count * sizeof(*sorted));
+	struct rtos_prefetch_region *regions = realloc(rtos->prefetched,
+			(rtos->prefetched_num + count) * sizeof(*regions));
+	if (!sorted || !regions) {
+		LOG_ERROR("Failed to alloc memory for prefetched regions!");
+		free(sorted);
+		if (regions)
+			rtos->prefetched = regions;
+		return ERROR_FAIL;
+	}
+	rtos->prefetched = regions;
+	int new_count = 0;
+	for (int i = 0; i < count; i++) {
+		if (!rtos_prefetch_find(rtos, ranges[i].address, ranges[i].size))
+			sorted[new_count++] = ranges[i];
+	}
+	count = new_count;
+	qsort(sorted, count, sizeof(*sorted), rtos_mem_range_cmp);
+
+	for (int i = 0; i < count; ) {
+		int64_t start = sorted[i].address;
+		int64_t end = start + sorted[i].size;
+		for (i++; i < count; i++) {
+			int64_t next_end = MAX(end, sorted[i].address + sorted[i].size);
+			if (sorted[i].address > end + RTOS_PREFETCH_MAX_GAP ||
+				next_end - start > RTOS_PREFETCH_MAX_REGION)
+				break;
+			end = next_end;
+		}
+		struct rtos_prefetch_region *region = &rtos->prefetched[rtos->prefetched_num];
+		region->address = start;
+		region->size = end - start;
+		region->data = malloc(region->size);
+		if (!region->data) {
+			LOG_ERROR("Failed to alloc memory for prefetched region!");
+			break;
+		}
+		int retval = target_read_buffer(rtos->target, region->address, region->size, region->data);
+		if (retval != ERROR_OK) {
+			/* not fatal, the data will be read on demand */
+			LOG_DEBUG("RTOS: failed to prefetch %" PRIu32 " bytes at 0x%" PRIx64,
+				region->size, region->address);
+			free(region->data);
+			continue;
+		}
+		LOG_DEBUG("RTOS: prefetched %" PRIu32 " bytes at 0x%" PRIx64, region->size, region->address);
+		rtos->prefetched_num++;
+	}
+	free(sorted);
+	rtos->prefetched_epoch = target_memory_epoch();
+	return ERROR_OK;
+}
+
+bool rtos_prefetch_valid(struct rtos *rtos)
+{
+	return rtos->prefetched && rtos->prefetched_epoch == target_memory_epoch();
+}
+
+void rtos_prefetch_free(struct rtos *rtos)
+{
+	for (int i = 0; i < rtos->prefetched_num; i++)
+		free(rtos->prefetched[i].data);
+	free(rtos->prefetched);
+	rtos->prefetched = NULL;
+	rtos->prefetched_num = 0;
+}
+
+/** Reads target memory, using data prefetched by rtos_prefetch() if possible. */
+int rtos_read_buffer(struct target *target, int64_t address, uint32_t size, uint8_t *buffer)
+{
+	struct rtos_prefetch_region *region = target->rtos ?
+		rtos_prefetch_find(target->rtos, address, size) : NULL;
+
+	if (region) {
+		memcpy(buffer, region->data + (address - region->address), size);
+		return ERROR_OK;
+	}
+	return target_read_buffer(target, address, size, buffer);
+}
+
 int rtos_generic_stack_read(struct target *target,
 	const struct rtos_register_stacking *stacking,
 	int64_t stack_ptr,
@@ -594,7 +719,7 @@ int rtos_generic_stack_read(struct target *target,
 	} else {
 		if (stacking->stack_growth_direction == 1)
 			address -= stacking->stack_registers_size;
-		retval = target_read_buffer(target, address, stacking->stack_registers_size, stack_data);
+		retval = rtos_read_buffer(target, address, stacking->stack_registers_size, stack_data);
 	}
 
 
@@ -682,6 +807,7 @@ void rtos_free_threadlist(struct rtos *rtos)
 		}
 		free(rtos->thread_details);
 		rtos->thread_details = NULL;
+		rtos_prefetch_free(rtos);
 		rtos->thread_count = 0;
 		rtos->current_threadid = -1;
 		rtos->current_thread = 0;
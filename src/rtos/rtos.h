@@ -27,6 +27,7 @@ typedef int64_t threadid_t;
 typedef int64_t symbol_address_t;
 
 struct reg;
+struct rtos_prefetch_region;
 
 /**
  * Table should be terminated by an element with NULL in symbol_name
@@ -62,6 +63,15 @@ struct rtos {
 	void *rtos_specific_data;
 	/*Threads that are currently running on cores of the target*/
 	int32_t* core_running_threads;
+	/* Memory (thread stack frames) read in advance for all threads, valid until the next resume */
+	struct rtos_prefetch_region *prefetched;
+	int prefetched_num;
+	uint32_t prefetched_epoch;
+};
+
+struct rtos_mem_range {
+	int64_t address;
+	uint32_t size;
 };
 
 struct rtos_reg {
@@ -128,6 +138,10 @@ int rtos_generic_stack_read(struct target *target,
 		int64_t stack_ptr,
 		struct rtos_reg **reg_list,
 		int *num_regs);
+int rtos_prefetch(struct rtos *rtos, const struct rtos_mem_range *ranges, int count);
+bool rtos_prefetch_valid(struct rtos *rtos);
+void rtos_prefetch_free(struct rtos *rtos);
+int rtos_read_buffer(struct target *target, int64_t address, uint32_t size, uint8_t *buffer);
 int rtos_try_next(struct target *target);
 int gdb_thread_packet(struct connection *connection, char const *packet, int packet_size);
 int rtos_get_gdb_reg(struct connection *connection, int reg_num);
@@ -459,7 +459,7 @@ static const struct rtos_register_stacking *rtos_freertos_esp_xtensa_pick_stacki
 		return stacking;
 
 	/* Read the stack pointer */
-	retval = target_read_buffer(rtos->target,
+	retval = rtos_read_buffer(rtos->target,
 			stack_addr,
 			4,
 			(uint8_t *)&stack_ptr);
@@ -468,7 +468,7 @@ static const struct rtos_register_stacking *rtos_freertos_esp_xtensa_pick_stacki
 	if (retval != ERROR_OK) {
 		return stacking;
 	}
-	retval = target_read_buffer(rtos->target,
+	retval = rtos_read_buffer(rtos->target,
 			stack_ptr,
 			4,
 			(uint8_t *)&stk_exit);
@@ -497,7 +497,7 @@ const struct rtos_register_stacking *rtos_freertos_esp32_s2_pick_stacking_info(s
 static int rtos_freertos_esp_xtensa_stack_read_involuntary(struct target *target, int64_t stack_ptr, const struct rtos_register_stacking *stacking, uint8_t *stack_data)
 {
 	int retval;
-	retval = target_read_buffer(target, stack_ptr, stacking->stack_registers_size, stack_data);
+	retval = rtos_read_buffer(target, stack_ptr, stacking->stack_registers_size, stack_data);
 	if (retval!=ERROR_OK) return retval;
 
 	stack_data[8]&=~0x10; //clear exception bit in PS
@@ -548,7 +548,7 @@ static int rtos_freertos_esp_xtensa_stack_read_voluntary(struct target *target,
 	uint32_t prevsp;
 	uint32_t xt_sol_pc_reg;
 
-	retval = target_read_buffer(target, stack_ptr-0x10, 4*8, stack_data);
+	retval = rtos_read_buffer(target, stack_ptr-0x10, 4*8, stack_data);
 	if (retval!=ERROR_OK) return retval;
 
 	stack_data[0x18]&=~0x10; //clear exception bit in PS
@@ -210,6 +210,12 @@ static int gdb_get_char_inner(struct connection *connection, int *next_char)
 #ifdef _DEBUG_GDB_IO_
 	char *debug_buffer;
 #endif
+	/* GDB will not answer until it gets everything we have sent */
+	if (connection_flush(connection) != ERROR_OK) {
+		gdb_con->closed = true;
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
 	for (;; ) {
 		if (connection->service->type != CONNECTION_TCP)
 			gdb_con->buf_cnt = read(connection->fd, gdb_con->buffer, GDB_BUFFER_SIZE);
@@ -1417,6 +1423,7 @@ static int gdb_error(struct connection *connection, int retval)
 /* We don't have to worry about the default 2 second timeout for GDB packets,
  * because GDB breaks up large memory reads into smaller reads.
  */
+/* Handles both 'm' (hex encoded reply) and 'x' (binary reply) memory read packets */
 static int gdb_read_memory_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
@@ -1424,9 +1431,10 @@ static int gdb_read_memory_packet(struct connection *connection,
 	char *separator;
 	uint64_t addr = 0;
 	uint32_t len = 0;
+	bool binary = packet[0] == 'x';
 
 	uint8_t *buffer;
-	char *hex_buffer;
+	char *reply;
 
 	int retval = ERROR_OK;
 
@@ -1443,12 +1451,25 @@ static int gdb_read_memory_packet(struct connection *connection,
 	len = strtoul(separator + 1, NULL, 16);
 
 	if (!len) {
+		if (binary) {
+			/* GDB probes for 'x' packet support this way */
+			gdb_put_packet(connection, "b", 1);
+			return ERROR_OK;
+		}
 		LOG_WARNING("invalid read memory packet received (len == 0)");
 		gdb_put_packet(connection, "", 0);
 		return ERROR_OK;
 	}
 
-	buffer = malloc(len);
+	/* Reply is built in place. Memory is read into the tail of the reply buffer and encoded
+	 * forward from its start. Encoding produces at most two chars per byte, so it never
+	 * overwrites data which are not encoded yet. */
+	reply = malloc(len * 2 + 1);
+	if (!reply) {
+		LOG_ERROR("Failed to allocate %" PRIu32 " bytes for memory read reply", len * 2 + 1);
+		return gdb_error(connection, ERROR_FAIL);
+	}
+	buffer = (uint8_t *)reply + len + 1;
 
 	LOG_DEBUG("addr: 0x%16.16" PRIx64 ", len: 0x%8.8" PRIx32 "", addr, len);
 
@@ -1473,17 +1494,26 @@ static int gdb_read_memory_packet(struct connection *connection,
 	}
 
 	if (retval == ERROR_OK) {
-		hex_buffer = malloc(len * 2 + 1);
-
-		size_t pkt_len = hexify(hex_buffer, buffer, len, len * 2 + 1);
-
-		gdb_put_packet(connection, hex_buffer, pkt_len);
+		size_t pkt_len;
+		if (binary) {
+			pkt_len = 0;
+			reply[pkt_len++] = 'b';
+			for (uint32_t i = 0; i < len; i++) {
+				uint8_t c = buffer[i];
+				if (c == '#' || c == '$' || c == '}' || c == '*') {
+					reply[pkt_len++] = '}';
+					c ^= 0x20;
+				}
+				reply[pkt_len++] = c;
+			}
+		} else
+			pkt_len = hexify(reply, buffer, len, len * 2 + 1);
 
-		free(hex_buffer);
+		gdb_put_packet(connection, reply, pkt_len);
 	} else
 		retval = gdb_error(connection, retval);
 
-	free(buffer);
+	free(reply);
 
 	return retval;
 }
@@ -2620,7 +2650,7 @@ static int gdb_query_packet(struct connection *connection,
 			&buffer,
 			&pos,
 			&size,
-			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+",
+			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+;binary-upload+",
 			GDB_BUFFER_SIZE,
 			((gdb_use_memory_map == 1) && (flash_get_bank_count() > 0)) ? '+' : '-',
 			(gdb_target_desc_supported == 1) ? '+' : '-');
@@ -3294,6 +3324,7 @@ static int gdb_input_inner(struct connection *connection)
 					retval = gdb_set_register_packet(connection, packet, packet_size);
 					break;
 				case 'm':
+				case 'x':
 					retval = gdb_read_memory_packet(connection, packet, packet_size);
 					break;
 				case 'M':
@@ -63,6 +63,35 @@ static int polling_period = 100;
 /* address by name on which to listen for incoming TCP/IP connections */
 static char *bindto_name;
 
+/* Pending output of a connection above this size is written in blocking mode */
+#define CONNECTION_OUTPUT_MAX	(1024 * 1024)
+
+#ifndef POLLIN
+struct pollfd {
+	int fd;
+	short events;
+	short revents;
+};
+#define POLLIN	0x0001
+#define POLLOUT	0x0004
+#define POLLERR	0x0008
+#define POLLHUP	0x0010
+#define POLLNVAL	0x0020
+#endif
+
+/* File descriptors watched by server_loop(), rebuilt only when services or connections change */
+struct server_pollfd_owner {
+	struct service *service;
+	struct connection *connection;	/* NULL for a listening descriptor */
+};
+static struct pollfd *server_pollfds;
+static struct server_pollfd_owner *server_pollfd_owners;
+static int server_pollfds_num;
+static int server_pollfds_size;
+static bool server_pollfds_dirty = true;
+
+static int connection_send_pending(struct connection *connection);
+
 static int add_connection(struct service *service, struct command_context *cmd_ctx)
 {
 	socklen_t address_size;
@@ -77,6 +106,9 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 	c->cmd_ctx = copy_command_context(cmd_ctx);
 	c->service = service;
 	c->input_pending = 0;
+	c->out_buf = NULL;
+	c->out_len = 0;
+	c->out_size = 0;
 	c->priv = NULL;
 	c->next = NULL;
 
@@ -155,6 +187,7 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 	for (p = &service->connections; *p; p = &(*p)->next)
 		;
 	*p = c;
+	server_pollfds_dirty = true;
 
 	if (service->max_connections != CONNECTION_LIMIT_UNLIMITED)
 		service->max_connections--;
@@ -171,8 +204,11 @@ static int remove_connection(struct service *service, struct connection *connect
 	while ((c = *p)) {
 		if (c->fd == connection->fd) {
 			service->connection_closed(c);
-			if (service->type == CONNECTION_TCP)
+			if (service->type == CONNECTION_TCP) {
+				/* best effort, do not wait for the peer which does not read */
+				connection_send_pending(c);
 				close_socket(c->fd);
+			}
 			else if (service->type == CONNECTION_PIPE) {
 				/* The service will listen to the pipe again */
 				c->service->fd = c->fd;
@@ -182,7 +218,9 @@ static int remove_connection(struct service *service, struct connection *connect
 
 			/* delete connection */
 			*p = c->next;
+			free(c->out_buf);
 			free(c);
+			server_pollfds_dirty = true;
 
 			if (service->max_connections != CONNECTION_LIMIT_UNLIMITED)
 				service->max_connections++;
@@ -345,6 +383,7 @@ int add_service(char *name,
 	for (p = &services; *p; p = &(*p)->next)
 		;
 	*p = c;
+	server_pollfds_dirty = true;
 
 	return ERROR_OK;
 }
@@ -385,6 +424,7 @@ int remove_service(const char *name, const char *port)
 
 			free(tmp->priv);
 			free_service(tmp);
+			server_pollfds_dirty = true;
 
 			return ERROR_OK;
 		}
@@ -424,21 +464,131 @@ static int remove_services(void)
 	}
 
 	services = NULL;
+	server_pollfds_dirty = true;
+
+	free(server_pollfds);
+	free(server_pollfd_owners);
+	server_pollfds = NULL;
+	server_pollfd_owners = NULL;
+	server_pollfds_size = 0;
+	server_pollfds_num = 0;
+
+	return ERROR_OK;
+}
 
+static int server_pollfd_add(int fd, struct service *service, struct connection *connection)
+{
+	if (server_pollfds_num == server_pollfds_size) {
+		int size = server_pollfds_size ? server_pollfds_size * 2 : 16;
+		struct pollfd *fds = realloc(server_pollfds, size * sizeof(*fds));
+		if (!fds)
+			return ERROR_FAIL;
+		server_pollfds = fds;
+		struct server_pollfd_owner *owners = realloc(server_pollfd_owners, size * sizeof(*owners));
+		if (!owners)
+			return ERROR_FAIL;
+		server_pollfd_owners = owners;
+		server_pollfds_size = size;
+	}
+	server_pollfds[server_pollfds_num].fd = fd;
+	server_pollfds[server_pollfds_num].events = POLLIN;
+	server_pollfds[server_pollfds_num].revents = 0;
+	server_pollfd_owners[server_pollfds_num].service = service;
+	server_pollfd_owners[server_pollfds_num].connection = connection;
+	server_pollfds_num++;
+	return ERROR_OK;
+}
+
+static int server_pollfds_rebuild(void)
+{
+	server_pollfds_num = 0;
+	for (struct service *service = services; service; service = service->next) {
+		/* listen for new connections */
+		if (service->fd != -1 && server_pollfd_add(service->fd, service, NULL) != ERROR_OK)
+			return ERROR_FAIL;
+		for (struct connection *c = service->connections; c; c = c->next) {
+			if (server_pollfd_add(c->fd, service, c) != ERROR_OK)
+				return ERROR_FAIL;
+		}
+	}
+	server_pollfds_dirty = false;
 	return ERROR_OK;
 }
 
+static int server_poll(int timeout_ms)
+{
+#ifdef HAVE_POLL_H
+	return poll(server_pollfds, server_pollfds_num, timeout_ms);
+#else
+	fd_set read_fds, write_fds;
+	int fd_max = 0;
+	struct timeval tv;
+
+	FD_ZERO(&read_fds);
+	FD_ZERO(&write_fds);
+	for (int i = 0; i < server_pollfds_num; i++) {
+		if (server_pollfds[i].events & POLLIN)
+			FD_SET(server_pollfds[i].fd, &read_fds);
+		if (server_pollfds[i].events & POLLOUT)
+			FD_SET(server_pollfds[i].fd, &write_fds);
+		if ((int)server_pollfds[i].fd > fd_max)
+			fd_max = server_pollfds[i].fd;
+	}
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	int retval = socket_select(fd_max + 1, &read_fds, &write_fds, NULL, &tv);
+	if (retval <= 0)
+		return retval;
+	for (int i = 0; i < server_pollfds_num; i++) {
+		server_pollfds[i].revents = 0;
+		if (FD_ISSET(server_pollfds[i].fd, &read_fds))
+			server_pollfds[i].revents |= POLLIN;
+		if (FD_ISSET(server_pollfds[i].fd, &write_fds))
+			server_pollfds[i].revents |= POLLOUT;
+	}
+	return retval;
+#endif
+}
+
+static void server_accept(struct service *service, struct command_context *command_context)
+{
+	/* pipe services stop listening once connected */
+	server_pollfds_dirty = true;
+	if (service->max_connections != 0) {
+		add_connection(service, command_context);
+		return;
+	}
+	if (service->type == CONNECTION_TCP) {
+		struct sockaddr_in sin;
+		socklen_t address_size = sizeof(sin);
+		int tmp_fd;
+		tmp_fd = accept(service->fd,
+				(struct sockaddr *)&service->sin,
+				&address_size);
+		close_socket(tmp_fd);
+	}
+	LOG_INFO("rejected '%s' connection, no more connections allowed",
+		service->name);
+}
+
+static void server_drop_connection(struct service *service, struct connection *c)
+{
+	if (service->type == CONNECTION_PIPE ||
+			service->type == CONNECTION_STDINOUT) {
+		/* if connection uses a pipe then
+		 * shutdown openocd on error */
+		shutdown_openocd = SHUTDOWN_REQUESTED;
+	}
+	remove_connection(service, c);
+	LOG_INFO("dropped '%s' connection", service->name);
+}
+
 int server_loop(struct command_context *command_context)
 {
 	struct service *service;
 
 	bool poll_ok = true;
 
-	/* used in select() */
-	fd_set read_fds;
-	int fd_max;
-
-	/* used in accept() */
 	int retval;
 
 #ifndef _WIN32
@@ -448,78 +598,59 @@ int server_loop(struct command_context *command_context)
 
 	while (shutdown_openocd == CONTINUE_MAIN_LOOP) {
 		/* monitor sockets for activity */
-		fd_max = 0;
-		FD_ZERO(&read_fds);
-
-		/* add service and connection fds to read_fds */
-		for (service = services; service; service = service->next) {
-			if (service->fd != -1) {
-				/* listen for new connections */
-				FD_SET(service->fd, &read_fds);
-
-				if (service->fd > fd_max)
-					fd_max = service->fd;
-			}
-
-			if (service->connections) {
-				struct connection *c;
-
-				for (c = service->connections; c; c = c->next) {
-					/* check for activity on the connection */
-					FD_SET(c->fd, &read_fds);
-					if (c->fd > fd_max)
-						fd_max = c->fd;
-				}
-			}
+		if (server_pollfds_dirty && server_pollfds_rebuild() != ERROR_OK) {
+			LOG_ERROR("Failed to alloc memory for server descriptors!");
+			return ERROR_FAIL;
+		}
+		for (int i = 0; i < server_pollfds_num; i++) {
+			struct connection *c = server_pollfd_owners[i].connection;
+			server_pollfds[i].events = POLLIN;
+			if (c && c->out_len > 0)
+				server_pollfds[i].events |= POLLOUT;
+			server_pollfds[i].revents = 0;
 		}
 
-		struct timeval tv;
-		tv.tv_sec = 0;
 		if (poll_ok) {
 			/* we're just polling this iteration, this is faster on embedded
 			 * hosts */
-			tv.tv_usec = 0;
-			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
+			retval = server_poll(0);
 		} else {
-			/* Every 100ms, can be changed with "poll_period" command */
-			tv.tv_usec = polling_period * 1000;
+			/* Sleep until the next timer callback is due, but at most 100ms,
+			 * can be changed with "poll_period" command */
+			int timeout = polling_period;
+			int64_t next_timer = target_timer_next_callback_delay();
+			if (next_timer >= 0 && next_timer < timeout)
+				timeout = next_timer;
 			/* Only while we're sleeping we'll let others run */
 			openocd_sleep_prelude();
 			kept_alive();
-			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
+			retval = server_poll(timeout);
 			openocd_sleep_postlude();
 		}
 
 		if (retval == -1) {
 #ifdef _WIN32
-
 			errno = WSAGetLastError();
-
-			if (errno == WSAEINTR)
-				FD_ZERO(&read_fds);
-			else {
-				LOG_ERROR("error during select: %s", strerror(errno));
-				return ERROR_FAIL;
-			}
+			if (errno != WSAEINTR) {
 #else
-
-			if (errno == EINTR)
-				FD_ZERO(&read_fds);
-			else {
-				LOG_ERROR("error during select: %s", strerror(errno));
+			if (errno != EINTR) {
+#endif
+				LOG_ERROR("error during poll: %s", strerror(errno));
 				return ERROR_FAIL;
 			}
-#endif
+			for (int i = 0; i < server_pollfds_num; i++)
+				server_pollfds[i].revents = 0;
 		}
 
+		/* Timer callbacks run only when they are due, so do not let a busy
+		 * connection starve them */
+		target_call_timer_callbacks();
+
 		if (retval == 0) {
 			/* We only execute these callbacks when there was nothing to do or we timed
 			 *out */
-			target_call_timer_callbacks();
 			process_jim_events(command_context);
 
-			FD_ZERO(&read_fds);	/* eCos leaves read_fds unchanged in this case!  */
-
 			/* We timed out/there was nothing to do, timeout rather than poll next time
 			 **/
 			poll_ok = false;
@@ -535,51 +666,47 @@ int server_loop(struct command_context *command_context)
 		 */
 		poll_ok = poll_ok || target_got_message();
 
-		for (service = services; service; service = service->next) {
+		/* Handlers may add or remove services and connections, stop walking the
+		 * descriptors then, the rest are reported again by the next poll */
+		for (int i = 0; i < server_pollfds_num && !server_pollfds_dirty; i++) {
+			short revents = server_pollfds[i].revents;
+			service = server_pollfd_owners[i].service;
+			struct connection *c = server_pollfd_owners[i].connection;
+
+			if (revents == 0)
+				continue;
+
 			/* handle new connections on listeners */
-			if ((service->fd != -1)
-				&& (FD_ISSET(service->fd, &read_fds))) {
-				if (service->max_connections != 0)
-					add_connection(service, command_context);
-				else {
-					if (service->type == CONNECTION_TCP) {
-						struct sockaddr_in sin;
-						socklen_t address_size = sizeof(sin);
-						int tmp_fd;
-						tmp_fd = accept(service->fd,
-								(struct sockaddr *)&service->sin,
-								&address_size);
-						close_socket(tmp_fd);
-					}
-					LOG_INFO(
-						"rejected '%s' connection, no more connections allowed",
-						service->name);
-				}
+			if (!c) {
+				server_accept(service, command_context);
+				continue;
+			}
+
+			/* send buffered output to clients which are ready to take it */
+			if ((revents & POLLOUT) && connection_send_pending(c) != ERROR_OK) {
+				server_drop_connection(service, c);
+				continue;
 			}
 
 			/* handle activity on connections */
-			if (service->connections) {
-				struct connection *c;
-
-				for (c = service->connections; c; ) {
-					if ((FD_ISSET(c->fd, &read_fds)) || c->input_pending) {
-						retval = service->input(c);
-						if (retval != ERROR_OK) {
-							struct connection *next = c->next;
-							if (service->type == CONNECTION_PIPE ||
-									service->type == CONNECTION_STDINOUT) {
-								/* if connection uses a pipe then
-								 * shutdown openocd on error */
-								shutdown_openocd = SHUTDOWN_REQUESTED;
-							}
-							remove_connection(service, c);
-							LOG_INFO("dropped '%s' connection",
-								service->name);
-							c = next;
-							continue;
-						}
+			if (revents & (POLLIN | POLLERR | POLLHUP | POLLNVAL)) {
+				retval = service->input(c);
+				if (retval != ERROR_OK)
+					server_drop_connection(service, c);
+			}
+		}
+
+		/* connections which have already buffered input */
+		for (service = services; service && !server_pollfds_dirty; service = service->next) {
+			struct connection *c;
+
+			for (c = service->connections; c; c = c->next) {
+				if (c->input_pending) {
+					retval = service->input(c);
+					if (retval != ERROR_OK) {
+						server_drop_connection(service, c);
+						break;
 					}
-					c = c->next;
 				}
 			}
 		}
@@ -716,16 +843,99 @@ void exit_on_signal(int sig)
 #endif
 }
 
+/* Sends as much of the buffered output as possible without blocking */
+static int connection_send_pending(struct connection *connection)
+{
+#ifdef MSG_DONTWAIT
+	int sent = 0;
+	while (sent < connection->out_len) {
+		int n = send(connection->fd_out, connection->out_buf + sent,
+				connection->out_len - sent, MSG_DONTWAIT);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			if (errno == EINTR)
+				continue;
+			connection->out_len = 0;
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+		sent += n;
+	}
+	connection->out_len -= sent;
+	memmove(connection->out_buf, connection->out_buf + sent, connection->out_len);
+#endif
+	return ERROR_OK;
+}
+
+/** Writes all buffered output of the connection, blocks until it is done. */
+int connection_flush(struct connection *connection)
+{
+	int sent = 0;
+
+	while (sent < connection->out_len) {
+		int n = write_socket(connection->fd_out, connection->out_buf + sent,
+				connection->out_len - sent);
+		if (n <= 0) {
+			connection->out_len = 0;
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+		sent += n;
+	}
+	connection->out_len = 0;
+	return ERROR_OK;
+}
+
+/*
+ * TCP output is written without blocking, whatever the peer can not take right now is
+ * buffered and sent by server_loop(), so one slow client does not stall the others.
+ * The return value is the length of the data unless the connection has failed.
+ */
 int connection_write(struct connection *connection, const void *data, int len)
 {
 	if (len == 0) {
 		/* successful no-op. Sockets and pipes behave differently here... */
 		return 0;
 	}
-	if (connection->service->type == CONNECTION_TCP)
-		return write_socket(connection->fd_out, data, len);
-	else
+	if (connection->service->type != CONNECTION_TCP)
 		return write(connection->fd_out, data, len);
+
+#ifdef MSG_DONTWAIT
+	int sent = 0;
+	if (connection->out_len == 0) {
+		sent = send(connection->fd_out, data, len, MSG_DONTWAIT);
+		if (sent == len)
+			return len;
+		if (sent < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				return sent;
+			sent = 0;
+		}
+	}
+	data = (const char *)data + sent;
+	int rest = len - sent;
+
+	if (connection->out_len + rest > CONNECTION_OUTPUT_MAX) {
+		/* the peer does not read, do not let the buffer grow unbounded */
+		if (connection_flush(connection) != ERROR_OK)
+			return -1;
+		return write_socket(connection->fd_out, data, rest) == rest ? len : -1;
+	}
+	if (connection->out_len + rest > connection->out_size) {
+		int size = MAX(connection->out_len + rest, 2 * connection->out_size);
+		char *buf = realloc(connection->out_buf, size);
+		if (!buf) {
+			LOG_ERROR("Failed to alloc memory for connection output!");
+			return -1;
+		}
+		connection->out_buf = buf;
+		connection->out_size = size;
+	}
+	memcpy(connection->out_buf + connection->out_len, data, rest);
+	connection->out_len += rest;
+	return len;
+#else
+	return write_socket(connection->fd_out, data, len);
+#endif
 }
 
 int connection_read(struct connection *connection, void *data, int len)
@@ -50,6 +50,10 @@ struct connection {
 	struct command_context *cmd_ctx;
 	struct service *service;
 	int input_pending;
+	/* TCP output which could not be sent without blocking, it is sent from server_loop() */
+	char *out_buf;
+	int out_len;
+	int out_size;
 	void *priv;
 	struct connection *next;
 };
@@ -92,6 +96,7 @@ int server_register_commands(struct command_context *context);
 
 int connection_write(struct connection *connection, const void *data, int len);
 int connection_read(struct connection *connection, void *data, int len);
+int connection_flush(struct connection *connection);
 
 /**
  * Used by server_loop(), defined in server_stubs.c
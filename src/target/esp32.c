@@ -519,6 +519,43 @@ static bool esp32_on_halt(struct target *target)
 	return esp_xtensa_on_halt(&xtensa_mcore->cores_targets[xtensa_mcore->active_core]);
 }
 
+/* Returns true if all cores except 'core_id' have been stopped by debug interrupt from that core only */
+static bool esp32_other_cores_stopped_by_di(struct xtensa_mcore_common *xtensa_mcore, size_t core_id)
+{
+	for (size_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
+		if (i == core_id)
+			continue;
+		xtensa_reg_val_t dbg_cause = xtensa_reg_get(&xtensa_mcore->cores_targets[i],
+			XT_REG_IDX_DEBUGCAUSE);
+		if (dbg_cause & ~DEBUGCAUSE_DI)
+			return false;
+	}
+	return true;
+}
+
+static bool esp32_on_fast_halt(struct target *target)
+{
+	struct xtensa_mcore_common *xtensa_mcore = target_to_xtensa_mcore(target);
+
+	for (size_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
+		struct target *sub_target = &xtensa_mcore->cores_targets[i];
+		if (!esp_xtensa_semihost_pending(sub_target))
+			continue;
+		/* other core can hit breakpoint/watchpoint at the same time, do not lose that halt,
+		 * semihosting call will be served on the regular halt */
+		if (!esp32_other_cores_stopped_by_di(xtensa_mcore, i)) {
+			target_to_xtensa(sub_target)->fast_halt_done = false;
+			return false;
+		}
+		int ret = esp32_disable_wdts(target);
+		if (ret != ERROR_OK)
+			return false;
+		xtensa_mcore->active_core = i;
+		return esp_xtensa_do_semihosting(sub_target) == ERROR_OK;
+	}
+	return false;
+}
+
 static int esp32_virt2phys(struct target *target,
 	target_addr_t virtual, target_addr_t *physical)
 {
@@ -704,6 +741,7 @@ static struct esp_xtensa_special_breakpoint_ops esp32_xtensa_spec_brp_ops = {
 static const struct xtensa_chip_ops esp32_chip_ops = {
 	.on_poll = esp32_on_poll,
 	.on_halt = esp32_on_halt,
+	.on_fast_halt = esp32_on_fast_halt,
 };
 
 static int esp32_target_create(struct target *target, Jim_Interp *interp)
@@ -817,6 +855,23 @@ COMMAND_HANDLER(esp32_cmd_semihost_basedir)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(esp32_cmd_semihost_stats)
+{
+	struct xtensa_mcore_common *xtensa_mcore = target_to_xtensa_mcore(get_current_target(
+			CMD_CTX));
+
+	for (int i = 0; i < xtensa_mcore->configured_cores_num; i++) {
+		if (CMD_ARGC == 0)
+			command_print(CMD, "CPU%d:", i);
+		int ret = CALL_COMMAND_HANDLER(esp_xtensa_cmd_semihost_stats_do,
+			target_to_esp_xtensa(&xtensa_mcore->cores_targets[i]));
+		if (ret != ERROR_OK)
+			return ret;
+	}
+
+	return ERROR_OK;
+}
+
 static const struct command_registration esp_any_command_handlers[] = {
 	{
 		.name = "semihost_basedir",
@@ -825,6 +880,13 @@ static const struct command_registration esp_any_command_handlers[] = {
 		.help = "Set the base directory for semohosting I/O.",
 		.usage = "dir",
 	},
+	{
+		.name = "semihost_stats",
+		.handler = esp32_cmd_semihost_stats,
+		.mode = COMMAND_EXEC,
+		.help = "Show or reset per syscall semihosting latency counters.",
+		.usage = "['reset']",
+	},
 	{
 		.mode = COMMAND_ANY,
 		.usage = "",
@@ -949,6 +1011,7 @@ struct target_type esp32_target = {
 	.write_buffer = xtensa_mcore_write_buffer,
 
 	.checksum_memory = xtensa_mcore_checksum_memory,
+	.profiling = xtensa_mcore_profiling,
 
 	.get_gdb_reg_list = xtensa_mcore_get_gdb_reg_list,
 
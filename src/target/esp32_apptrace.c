@@ -28,10 +28,15 @@
 #endif
 
 #include <pthread.h>
+#ifdef HAVE_NETDB_H
+#include <netdb.h>
+#endif
+#ifndef _WIN32
+#include <netinet/in.h>
+#endif
 #include "target.h"
 #include "target_type.h"
 #include "time_support.h"
-#include "list.h"
 #include "xtensa_mcore.h"
 #include "esp_xtensa.h"
 #include "esp_xtensa_apptrace.h"
@@ -56,17 +61,18 @@
 #define ESP32_APPTRACE_TGT_STATE_TMO            5000
 #define ESP_APPTRACE_TIME_STATS_ENABLE      1
 #define ESP_APPTRACE_BLOCKS_POOL_SZ         10
-
-#define ESP_APPTRACE_FILE_CMD_FOPEN     0x0
-#define ESP_APPTRACE_FILE_CMD_FCLOSE    0x1
-#define ESP_APPTRACE_FILE_CMD_FWRITE    0x2
-#define ESP_APPTRACE_FILE_CMD_FREAD     0x3
-#define ESP_APPTRACE_FILE_CMD_FSEEK     0x4
-#define ESP_APPTRACE_FILE_CMD_FTELL     0x5
-#define ESP_APPTRACE_FILE_CMD_FTELL     0x5
-#define ESP_APPTRACE_FILE_CMD_STOP      0x6	/* indicates that there is no files to transfer */
+/* size of the ring buffer used by TCP destination to decouple trace polling from socket writes */
+#define ESP_APPTRACE_TCP_RING_SZ            (1024*1024)
+/* period to check for stop request while TCP destination sender waits for client */
+#define ESP_APPTRACE_TCP_ACCEPT_TMO_MS      100
+/* period to check for stop request while TCP destination sender waits for client to read data */
+#define ESP_APPTRACE_TCP_SEND_TMO_MS        500
+/* size of the buffer between data processor and per-destination output worker */
+#define ESP_APPTRACE_DEST_WORKER_BUF_SZ     (256*1024)
 
 #define ESP_GCOV_FILES_MAX_NUM          512
+/* size of the stdio buffer of every gcov file, data are written to disk when it is full or on close */
+#define ESP_GCOV_FILE_BUF_SZ            (64*1024)
 
 /* grabbed from SystemView target sources */
 #define   SYSVIEW_EVTID_NOP                 0	/* Dummy packet. */
@@ -136,6 +142,7 @@ struct esp32_apptrace_target_state {
 struct esp32_apptrace_cmd_stats {
 	uint32_t incompl_blocks;
 	uint32_t lost_bytes;
+	uint32_t dropped_bytes;
 #if ESP_APPTRACE_TIME_STATS_ENABLE
 	float min_blk_read_time;
 	float max_blk_read_time;
@@ -148,13 +155,51 @@ struct esp32_apptrace_dest_file_data {
 	int fout;
 };
 
+/* TCP destination. Trace data are put into the ring buffer by data processor thread and
+ * sent to the client by dedicated sender thread, so slow or absent consumer never stalls
+ * trace polling. When there is no space in the ring incoming data are dropped and accounted. */
+struct esp32_apptrace_dest_tcp_data {
+	int listen_sock;
+	int client_sock;
+	pthread_t sender;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool stop;
+	uint8_t *ring;
+	uint32_t ring_sz;
+	uint32_t rd_pos;
+	uint32_t count;
+	uint32_t dropped_bytes;
+};
+
 typedef int (*esp32_apptrace_dest_write_t)(void *priv, uint8_t *data, uint32_t size);
 typedef int (*esp32_apptrace_dest_cleanup_t)(void *priv);
+typedef uint32_t (*esp32_apptrace_dest_dropped_t)(void *priv);
 
 struct esp32_apptrace_dest {
 	void *priv;
 	esp32_apptrace_dest_write_t write;
 	esp32_apptrace_dest_cleanup_t clean;
+	/* optional, returns number of bytes dropped by destination */
+	esp32_apptrace_dest_dropped_t dropped;
+};
+
+/* Output worker wrapping blocking destination. Data processor only parses trace data and
+ * appends the output to the worker's buffer. Every destination (one per core in SystemView
+ * mode) is written by its own thread, data are written in the order they were produced.
+ * Unlike TCP destination nothing is dropped, writer waits for free space. */
+struct esp32_apptrace_dest_worker_data {
+	struct esp32_apptrace_dest dest;
+	pthread_t worker;
+	pthread_mutex_t lock;
+	pthread_cond_t data_cond;
+	pthread_cond_t space_cond;
+	bool stop;
+	int error;
+	uint8_t *buf;
+	uint32_t buf_sz;
+	uint32_t rd_pos;
+	uint32_t count;
 };
 
 struct esp32_apptrace_cmd_ctx;
@@ -163,11 +208,18 @@ typedef int (*esp32_apptrace_process_data_t)(struct esp32_apptrace_cmd_ctx *ctx,
 	uint8_t *data, uint32_t data_len);
 
 struct esp32_apptrace_block {
-	struct hlist_node node;
 	uint8_t *data;
 	uint32_t data_len;
 };
 
+/* FIFO of trace blocks. Every queue can hold the whole pool, so it never overflows.
+ * Free queue is filled by data processor and drained by poller, ready queue works vice versa. */
+struct esp32_apptrace_block_queue {
+	struct esp32_apptrace_block *blocks[ESP_APPTRACE_BLOCKS_POOL_SZ];
+	uint32_t rd_pos;
+	uint32_t count;
+};
+
 struct esp32_apptrace_cmd_ctx {
 	volatile int running;
 	int mode;
@@ -177,8 +229,9 @@ struct esp32_apptrace_cmd_ctx {
 	int cores_num;
 	uint32_t last_blk_id;
 	pthread_mutex_t trax_blocks_mux;
-	struct hlist_head free_trax_blocks;
-	struct hlist_head ready_trax_blocks;
+	pthread_cond_t trax_blocks_ready;
+	struct esp32_apptrace_block_queue free_trax_blocks;
+	struct esp32_apptrace_block_queue ready_trax_blocks;
 	uint8_t *trax_block_data;
 	uint32_t trax_block_sz;
 	pthread_t data_processor;
@@ -198,6 +251,9 @@ struct esp32_apptrace_cmd_data {
 	uint32_t sv_acc_time_delta;
 	int sv_last_core_id;
 	int sv_trace_running;
+	/* buffer to assemble packets with re-encoded time delta */
+	uint8_t *sv_pkt_buf;
+	uint32_t sv_pkt_buf_sz;
 	uint32_t max_len;
 	uint32_t skip_len;
 	bool wait4halt;
@@ -287,15 +343,422 @@ static int esp32_apptrace_file_dest_init(struct esp32_apptrace_dest *dest, const
 	return ERROR_OK;
 }
 
+static int esp32_apptrace_tcp_dest_write(void *priv, uint8_t *data, uint32_t size)
+{
+	struct esp32_apptrace_dest_tcp_data *dest_data =
+		(struct esp32_apptrace_dest_tcp_data *)priv;
+
+	pthread_mutex_lock(&dest_data->lock);
+	if (size > dest_data->ring_sz - dest_data->count) {
+		/* never block here, consumer is too slow or not connected */
+		dest_data->dropped_bytes += size;
+		pthread_mutex_unlock(&dest_data->lock);
+		return ERROR_OK;
+	}
+	uint32_t wr_pos = (dest_data->rd_pos + dest_data->count) % dest_data->ring_sz;
+	uint32_t wr_sz = MIN(size, dest_data->ring_sz - wr_pos);
+	memcpy(&dest_data->ring[wr_pos], data, wr_sz);
+	if (wr_sz < size)
+		memcpy(dest_data->ring, &data[wr_sz], size - wr_sz);
+	dest_data->count += size;
+	pthread_cond_signal(&dest_data->cond);
+	pthread_mutex_unlock(&dest_data->lock);
+	return ERROR_OK;
+}
+
+static uint32_t esp32_apptrace_tcp_dest_dropped(void *priv)
+{
+	struct esp32_apptrace_dest_tcp_data *dest_data =
+		(struct esp32_apptrace_dest_tcp_data *)priv;
+
+	pthread_mutex_lock(&dest_data->lock);
+	uint32_t dropped = dest_data->dropped_bytes;
+	pthread_mutex_unlock(&dest_data->lock);
+	return dropped;
+}
+
+static int esp32_apptrace_tcp_dest_accept(struct esp32_apptrace_dest_tcp_data *dest_data)
+{
+	fd_set read_fds;
+	struct timeval tv;
+
+	FD_ZERO(&read_fds);
+	FD_SET(dest_data->listen_sock, &read_fds);
+	tv.tv_sec = 0;
+	tv.tv_usec = ESP_APPTRACE_TCP_ACCEPT_TMO_MS * 1000;
+	if (socket_select(dest_data->listen_sock + 1, &read_fds, NULL, NULL, &tv) <= 0)
+		return -1;
+	int sock = accept(dest_data->listen_sock, NULL, NULL);
+	if (sock < 0)
+		return -1;
+	/* sender must be able to notice stop request when client does not read data */
+	socket_nonblock(sock);
+	LOG_INFO("Trace TCP client connected");
+	return sock;
+}
+
+/* Returns number of bytes sent, 0 if client is not ready to receive data, or negative value on error */
+static int esp32_apptrace_tcp_dest_send(struct esp32_apptrace_dest_tcp_data *dest_data,
+	uint8_t *data, uint32_t len)
+{
+	fd_set write_fds;
+	struct timeval tv;
+
+	FD_ZERO(&write_fds);
+	FD_SET(dest_data->client_sock, &write_fds);
+	tv.tv_sec = 0;
+	tv.tv_usec = ESP_APPTRACE_TCP_SEND_TMO_MS * 1000;
+	int res = socket_select(dest_data->client_sock + 1, NULL, &write_fds, NULL, &tv);
+	if (res <= 0)
+		return res;
+	int wr_sz = write_socket(dest_data->client_sock, data, len);
+	if (wr_sz < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return 0;
+	return wr_sz == 0 ? -1 : wr_sz;
+}
+
+static void *esp32_apptrace_tcp_dest_sender(void *arg)
+{
+	struct esp32_apptrace_dest_tcp_data *dest_data =
+		(struct esp32_apptrace_dest_tcp_data *)arg;
+
+	while (1) {
+		if (dest_data->client_sock < 0) {
+			pthread_mutex_lock(&dest_data->lock);
+			bool stop = dest_data->stop;
+			pthread_mutex_unlock(&dest_data->lock);
+			/* in connecting mode the peer is gone, nothing to do until stop */
+			if (stop || dest_data->listen_sock < 0)
+				break;
+			dest_data->client_sock = esp32_apptrace_tcp_dest_accept(dest_data);
+			continue;
+		}
+		pthread_mutex_lock(&dest_data->lock);
+		while (!dest_data->stop && dest_data->count == 0)
+			pthread_cond_wait(&dest_data->cond, &dest_data->lock);
+		if (dest_data->count == 0) {
+			/* stop requested and all data are flushed */
+			pthread_mutex_unlock(&dest_data->lock);
+			break;
+		}
+		/* writer only appends behind the pending region, so it is safe to send
+		 * directly from the ring without holding the lock */
+		uint8_t *data = &dest_data->ring[dest_data->rd_pos];
+		uint32_t len = MIN(dest_data->count, dest_data->ring_sz - dest_data->rd_pos);
+		pthread_mutex_unlock(&dest_data->lock);
+
+		int wr_sz = esp32_apptrace_tcp_dest_send(dest_data, data, len);
+		if (wr_sz == 0) {
+			/* client does not read data, do not let it block the stop */
+			pthread_mutex_lock(&dest_data->lock);
+			bool stop = dest_data->stop;
+			pthread_mutex_unlock(&dest_data->lock);
+			if (stop)
+				break;
+			continue;
+		}
+		if (wr_sz < 0) {
+			LOG_INFO("Trace TCP client disconnected");
+			close_socket(dest_data->client_sock);
+			dest_data->client_sock = -1;
+			continue;
+		}
+		pthread_mutex_lock(&dest_data->lock);
+		dest_data->rd_pos = (dest_data->rd_pos + wr_sz) % dest_data->ring_sz;
+		dest_data->count -= wr_sz;
+		pthread_mutex_unlock(&dest_data->lock);
+	}
+	return NULL;
+}
+
+static void esp32_apptrace_tcp_dest_free(struct esp32_apptrace_dest_tcp_data *dest_data)
+{
+	if (dest_data->client_sock >= 0)
+		close_socket(dest_data->client_sock);
+	if (dest_data->listen_sock >= 0)
+		close_socket(dest_data->listen_sock);
+	pthread_cond_destroy(&dest_data->cond);
+	pthread_mutex_destroy(&dest_data->lock);
+	free(dest_data->ring);
+	free(dest_data);
+}
+
+static int esp32_apptrace_tcp_dest_cleanup(void *priv)
+{
+	struct esp32_apptrace_dest_tcp_data *dest_data =
+		(struct esp32_apptrace_dest_tcp_data *)priv;
+
+	pthread_mutex_lock(&dest_data->lock);
+	dest_data->stop = true;
+	pthread_cond_signal(&dest_data->cond);
+	pthread_mutex_unlock(&dest_data->lock);
+	pthread_join(dest_data->sender, NULL);
+	if (dest_data->count)
+		LOG_WARNING("Trace TCP destination: %u bytes were not sent", dest_data->count);
+	esp32_apptrace_tcp_dest_free(dest_data);
+	return ERROR_OK;
+}
+
+static int esp32_apptrace_tcp_dest_listen(struct esp32_apptrace_dest_tcp_data *dest_data,
+	uint16_t port)
+{
+	struct sockaddr_in sin;
+	int opt = 1;
+
+	dest_data->listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+	if (dest_data->listen_sock < 0) {
+		LOG_ERROR("Failed to create socket (%d)!", errno);
+		return ERROR_FAIL;
+	}
+	setsockopt(dest_data->listen_sock, SOL_SOCKET, SO_REUSEADDR, (void *)&opt, sizeof(int));
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_ANY);
+	sin.sin_port = htons(port);
+	if (bind(dest_data->listen_sock, (struct sockaddr *)&sin, sizeof(sin)) != 0 ||
+		listen(dest_data->listen_sock, 1) != 0) {
+		LOG_ERROR("Failed to listen on port %u (%d)!", port, errno);
+		return ERROR_FAIL;
+	}
+	LOG_INFO("Listening for trace TCP client on port %u", port);
+	return ERROR_OK;
+}
+
+static int esp32_apptrace_tcp_dest_connect(struct esp32_apptrace_dest_tcp_data *dest_data,
+	const char *host, const char *port)
+{
+	struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+	struct addrinfo *result, *rp;
+
+	if (getaddrinfo(host, port, &hints, &result) != 0) {
+		LOG_ERROR("Failed to resolve host '%s'!", host);
+		return ERROR_FAIL;
+	}
+	for (rp = result; rp; rp = rp->ai_next) {
+		dest_data->client_sock = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+		if (dest_data->client_sock < 0)
+			continue;
+		if (connect(dest_data->client_sock, rp->ai_addr, rp->ai_addrlen) == 0)
+			break;
+		close_socket(dest_data->client_sock);
+		dest_data->client_sock = -1;
+	}
+	freeaddrinfo(result);
+	if (!rp) {
+		LOG_ERROR("Failed to connect to %s:%s!", host, port);
+		return ERROR_FAIL;
+	}
+	socket_nonblock(dest_data->client_sock);
+	LOG_INFO("Connected to trace TCP consumer %s:%s", host, port);
+	return ERROR_OK;
+}
+
+/* dest_name is "host:port" to connect to the consumer or ":port" to wait for it */
+static int esp32_apptrace_tcp_dest_init(struct esp32_apptrace_dest *dest, const char *dest_name)
+{
+	char host[256];
+	const char *port = strrchr(dest_name, ':');
+	if (!port || port[1] == '\0' || (size_t)(port - dest_name) >= sizeof(host)) {
+		LOG_ERROR("Invalid TCP destination '%s'! Expected [host]:port.", dest_name);
+		return ERROR_FAIL;
+	}
+	memcpy(host, dest_name, port - dest_name);
+	host[port - dest_name] = '\0';
+	port++;
+
+	struct esp32_apptrace_dest_tcp_data *dest_data =
+		calloc(1, sizeof(struct esp32_apptrace_dest_tcp_data));
+	if (!dest_data) {
+		LOG_ERROR("Failed to alloc mem for TCP dest!");
+		return ERROR_FAIL;
+	}
+	dest_data->listen_sock = -1;
+	dest_data->client_sock = -1;
+	dest_data->ring_sz = ESP_APPTRACE_TCP_RING_SZ;
+	pthread_mutex_init(&dest_data->lock, NULL);
+	pthread_cond_init(&dest_data->cond, NULL);
+	dest_data->ring = malloc(dest_data->ring_sz);
+	if (!dest_data->ring) {
+		LOG_ERROR("Failed to alloc mem for TCP dest ring!");
+		esp32_apptrace_tcp_dest_free(dest_data);
+		return ERROR_FAIL;
+	}
+
+	int res;
+	if (host[0] == '\0')
+		res = esp32_apptrace_tcp_dest_listen(dest_data, strtoul(port, NULL, 10));
+	else
+		res = esp32_apptrace_tcp_dest_connect(dest_data, host, port);
+	if (res != ERROR_OK) {
+		esp32_apptrace_tcp_dest_free(dest_data);
+		return res;
+	}
+	if (pthread_create(&dest_data->sender, NULL, esp32_apptrace_tcp_dest_sender, dest_data)) {
+		LOG_ERROR("Failed to create TCP dest sender thread!");
+		esp32_apptrace_tcp_dest_free(dest_data);
+		return ERROR_FAIL;
+	}
+
+	dest->priv = dest_data;
+	dest->write = esp32_apptrace_tcp_dest_write;
+	dest->clean = esp32_apptrace_tcp_dest_cleanup;
+	dest->dropped = esp32_apptrace_tcp_dest_dropped;
+
+	return ERROR_OK;
+}
+
+static int esp32_apptrace_worker_dest_write(void *priv, uint8_t *data, uint32_t size)
+{
+	struct esp32_apptrace_dest_worker_data *dest_data =
+		(struct esp32_apptrace_dest_worker_data *)priv;
+
+	pthread_mutex_lock(&dest_data->lock);
+	while (size > 0 && dest_data->error == ERROR_OK) {
+		while (dest_data->count == dest_data->buf_sz && dest_data->error == ERROR_OK)
+			pthread_cond_wait(&dest_data->space_cond, &dest_data->lock);
+		if (dest_data->error != ERROR_OK)
+			break;
+		uint32_t wr_pos = (dest_data->rd_pos + dest_data->count) % dest_data->buf_sz;
+		uint32_t wr_sz = MIN(size, dest_data->buf_sz - dest_data->count);
+		wr_sz = MIN(wr_sz, dest_data->buf_sz - wr_pos);
+		memcpy(&dest_data->buf[wr_pos], data, wr_sz);
+		dest_data->count += wr_sz;
+		data += wr_sz;
+		size -= wr_sz;
+		pthread_cond_signal(&dest_data->data_cond);
+	}
+	int res = dest_data->error;
+	pthread_mutex_unlock(&dest_data->lock);
+	return res;
+}
+
+static uint32_t esp32_apptrace_worker_dest_dropped(void *priv)
+{
+	struct esp32_apptrace_dest_worker_data *dest_data =
+		(struct esp32_apptrace_dest_worker_data *)priv;
+
+	return dest_data->dest.dropped ? dest_data->dest.dropped(dest_data->dest.priv) : 0;
+}
+
+static void *esp32_apptrace_dest_worker(void *arg)
+{
+	struct esp32_apptrace_dest_worker_data *dest_data =
+		(struct esp32_apptrace_dest_worker_data *)arg;
+
+	pthread_mutex_lock(&dest_data->lock);
+	while (1) {
+		while (!dest_data->stop && dest_data->count == 0)
+			pthread_cond_wait(&dest_data->data_cond, &dest_data->lock);
+		if (dest_data->count == 0)
+			break;
+		/* writer only appends behind the pending region, so it is safe to pass the data
+		 * to the destination directly from the buffer without holding the lock */
+		uint8_t *data = &dest_data->buf[dest_data->rd_pos];
+		uint32_t len = MIN(dest_data->count, dest_data->buf_sz - dest_data->rd_pos);
+		pthread_mutex_unlock(&dest_data->lock);
+		int res = dest_data->dest.write(dest_data->dest.priv, data, len);
+		pthread_mutex_lock(&dest_data->lock);
+		if (res != ERROR_OK) {
+			/* discard the rest, writer will see the error on the next write */
+			dest_data->error = res;
+			dest_data->count = 0;
+			pthread_cond_signal(&dest_data->space_cond);
+			break;
+		}
+		dest_data->rd_pos = (dest_data->rd_pos + len) % dest_data->buf_sz;
+		dest_data->count -= len;
+		pthread_cond_signal(&dest_data->space_cond);
+	}
+	pthread_mutex_unlock(&dest_data->lock);
+	return NULL;
+}
+
+static void esp32_apptrace_worker_dest_free(struct esp32_apptrace_dest_worker_data *dest_data)
+{
+	pthread_cond_destroy(&dest_data->space_cond);
+	pthread_cond_destroy(&dest_data->data_cond);
+	pthread_mutex_destroy(&dest_data->lock);
+	free(dest_data->buf);
+	free(dest_data);
+}
+
+static int esp32_apptrace_worker_dest_cleanup(void *priv)
+{
+	struct esp32_apptrace_dest_worker_data *dest_data =
+		(struct esp32_apptrace_dest_worker_data *)priv;
+
+	/* let worker flush pending data and exit */
+	pthread_mutex_lock(&dest_data->lock);
+	dest_data->stop = true;
+	pthread_cond_signal(&dest_data->data_cond);
+	pthread_mutex_unlock(&dest_data->lock);
+	pthread_join(dest_data->worker, NULL);
+
+	int res = dest_data->error;
+	if (dest_data->dest.clean(dest_data->dest.priv) != ERROR_OK)
+		res = ERROR_FAIL;
+	esp32_apptrace_worker_dest_free(dest_data);
+	return res;
+}
+
+/* Moves writes to the initialized destination 'dest' into dedicated output thread */
+static int esp32_apptrace_worker_dest_init(struct esp32_apptrace_dest *dest)
+{
+	struct esp32_apptrace_dest_worker_data *dest_data =
+		calloc(1, sizeof(struct esp32_apptrace_dest_worker_data));
+	if (!dest_data) {
+		LOG_ERROR("Failed to alloc mem for dest worker!");
+		return ERROR_FAIL;
+	}
+	dest_data->buf_sz = ESP_APPTRACE_DEST_WORKER_BUF_SZ;
+	pthread_mutex_init(&dest_data->lock, NULL);
+	pthread_cond_init(&dest_data->data_cond, NULL);
+	pthread_cond_init(&dest_data->space_cond, NULL);
+	dest_data->buf = malloc(dest_data->buf_sz);
+	if (!dest_data->buf) {
+		LOG_ERROR("Failed to alloc mem for dest worker buffer!");
+		esp32_apptrace_worker_dest_free(dest_data);
+		return ERROR_FAIL;
+	}
+	dest_data->dest = *dest;
+	if (pthread_create(&dest_data->worker, NULL, esp32_apptrace_dest_worker, dest_data)) {
+		LOG_ERROR("Failed to create dest worker thread!");
+		esp32_apptrace_worker_dest_free(dest_data);
+		return ERROR_FAIL;
+	}
+
+	dest->priv = dest_data;
+	dest->write = esp32_apptrace_worker_dest_write;
+	dest->clean = esp32_apptrace_worker_dest_cleanup;
+	dest->dropped = esp32_apptrace_worker_dest_dropped;
+
+	return ERROR_OK;
+}
+
+/* If 'pipeline' is true blocking destinations are written by dedicated output threads */
 static int esp32_apptrace_dest_init(struct esp32_apptrace_dest dest[],
 	const char *dest_paths[],
-	int max_dests)
+	int max_dests,
+	bool pipeline)
 {
 	int res = ERROR_OK, i;
 
 	for (i = 0; i < max_dests; i++) {
 		if (strncmp(dest_paths[i], "file://", 7) == 0) {
 			res = esp32_apptrace_file_dest_init(&dest[i], &dest_paths[i][7]);
+			if (res == ERROR_OK && pipeline) {
+				res = esp32_apptrace_worker_dest_init(&dest[i]);
+				if (res != ERROR_OK) {
+					dest[i].clean(dest[i].priv);
+					memset(&dest[i], 0, sizeof(dest[i]));
+				}
+			}
+			if (res != ERROR_OK) {
+				LOG_ERROR("Failed to init destination '%s'!", dest_paths[i]);
+				return 0;
+			}
+		} else if (strncmp(dest_paths[i], "tcp://", 6) == 0) {
+			res = esp32_apptrace_tcp_dest_init(&dest[i], &dest_paths[i][6]);
 			if (res != ERROR_OK) {
 				LOG_ERROR("Failed to init destination '%s'!", dest_paths[i]);
 				return 0;
@@ -309,36 +772,45 @@ static int esp32_apptrace_dest_init(struct esp32_apptrace_dest dest[],
 
 static int esp32_apptrace_dest_cleanup(struct esp32_apptrace_dest dest[], int max_dests)
 {
+	int res = ERROR_OK;
+
 	for (int i = 0; i < max_dests; i++) {
-		if (dest[i].clean)
-			return dest[i].clean(dest[i].priv);
+		if (dest[i].clean && dest[i].clean(dest[i].priv) != ERROR_OK)
+			res = ERROR_FAIL;
 	}
-	return ERROR_OK;
+	return res;
 }
 
 /*********************************************************************
 *                 Trace data blocks management API
 **********************************************************************/
 
+static void esp32_apptrace_block_enqueue(struct esp32_apptrace_block_queue *queue,
+	struct esp32_apptrace_block *block)
+{
+	queue->blocks[(queue->rd_pos + queue->count) % ESP_APPTRACE_BLOCKS_POOL_SZ] = block;
+	queue->count++;
+}
+
+static struct esp32_apptrace_block *esp32_apptrace_block_dequeue(
+	struct esp32_apptrace_block_queue *queue)
+{
+	if (queue->count == 0)
+		return NULL;
+	struct esp32_apptrace_block *block = queue->blocks[queue->rd_pos];
+	queue->rd_pos = (queue->rd_pos + 1) % ESP_APPTRACE_BLOCKS_POOL_SZ;
+	queue->count--;
+	return block;
+}
+
 static void esp32_apptrace_blocks_pool_cleanup(struct esp32_apptrace_cmd_ctx *ctx)
 {
 	struct esp32_apptrace_block *cur;
-	struct hlist_node *pos, *tmp;
-	hlist_for_each_entry_safe(cur, pos, tmp, &ctx->free_trax_blocks, node) {
-		if (cur) {
-			hlist_del(&cur->node);
-			if (cur->data)
-				free(cur->data);
-			free(cur);
-		}
-	}
-	hlist_for_each_entry_safe(cur, pos, tmp, &ctx->ready_trax_blocks, node) {
-		if (cur) {
-			hlist_del(&cur->node);
-			if (cur->data)
-				free(cur->data);
-			free(cur);
-		}
+
+	while ((cur = esp32_apptrace_block_dequeue(&ctx->free_trax_blocks)) ||
+		(cur = esp32_apptrace_block_dequeue(&ctx->ready_trax_blocks))) {
+		free(cur->data);
+		free(cur);
 	}
 }
 
@@ -349,13 +821,7 @@ static struct esp32_apptrace_block *esp32_apptrace_free_block_get(
 
 	int res = pthread_mutex_lock(&ctx->trax_blocks_mux);
 	if (res == 0) {
-		if (!hlist_empty(&ctx->free_trax_blocks)) {
-			/*get first */
-			block = hlist_entry(ctx->free_trax_blocks.first,
-				struct esp32_apptrace_block,
-				node);
-			hlist_del(&block->node);
-		}
+		block = esp32_apptrace_block_dequeue(&ctx->free_trax_blocks);
 		res = pthread_mutex_unlock(&ctx->trax_blocks_mux);
 		if (res)
 			LOG_ERROR("Failed to unlock blocks pool (%d)!", res);
@@ -372,9 +838,9 @@ static int esp32_apptrace_ready_block_put(struct esp32_apptrace_cmd_ctx *ctx,
 	res = pthread_mutex_lock(&ctx->trax_blocks_mux);
 	if (res == 0) {
 		LOG_DEBUG("esp32_apptrace_ready_block_put");
-		/* add to ready blocks list */
-		INIT_HLIST_NODE(&block->node);
-		hlist_add_head(&block->node, &ctx->ready_trax_blocks);
+		/* add to ready blocks queue and wake up data processor */
+		esp32_apptrace_block_enqueue(&ctx->ready_trax_blocks, block);
+		pthread_cond_signal(&ctx->trax_blocks_ready);
 		res = pthread_mutex_unlock(&ctx->trax_blocks_mux);
 		if (res) {
 			LOG_ERROR("Failed to unlock blocks pool (%d)!", res);
@@ -389,23 +855,22 @@ static int esp32_apptrace_ready_block_put(struct esp32_apptrace_cmd_ctx *ctx,
 	return res;
 }
 
+/* Blocks until there is a ready block or tracing is stopped. In the latter case returns NULL. */
 static struct esp32_apptrace_block *esp32_apptrace_ready_block_get(
 	struct esp32_apptrace_cmd_ctx *ctx)
 {
 	struct esp32_apptrace_block *block = NULL;
 
-	if (pthread_mutex_trylock(&ctx->trax_blocks_mux) == 0) {
-		if (!hlist_empty(&ctx->ready_trax_blocks)) {
-			struct hlist_node *tmp;
-			/* find to the last */
-			hlist_for_each_entry(block, tmp, &ctx->ready_trax_blocks, node);
-			/* remove it from ready list */
-			hlist_del(&block->node);
-		}
-		int res = pthread_mutex_unlock(&ctx->trax_blocks_mux);
+	int res = pthread_mutex_lock(&ctx->trax_blocks_mux);
+	if (res == 0) {
+		while (ctx->running && ctx->ready_trax_blocks.count == 0)
+			pthread_cond_wait(&ctx->trax_blocks_ready, &ctx->trax_blocks_mux);
+		block = esp32_apptrace_block_dequeue(&ctx->ready_trax_blocks);
+		res = pthread_mutex_unlock(&ctx->trax_blocks_mux);
 		if (res)
 			LOG_ERROR("Failed to unlock blocks pool (%d)!", res);
-	}
+	} else
+		LOG_ERROR("Failed to lock blocks pool (%d)!", res);
 
 	return block;
 }
@@ -417,9 +882,8 @@ static int esp32_apptrace_block_free(struct esp32_apptrace_cmd_ctx *ctx,
 
 	res = pthread_mutex_lock(&ctx->trax_blocks_mux);
 	if (res == 0) {
-		/* add to free blocks list */
-		INIT_HLIST_NODE(&block->node);
-		hlist_add_head(&block->node, &ctx->free_trax_blocks);
+		/* add to free blocks queue */
+		esp32_apptrace_block_enqueue(&ctx->free_trax_blocks, block);
 		res = pthread_mutex_unlock(&ctx->trax_blocks_mux);
 		if (res) {
 			LOG_ERROR("Failed to unlock blocks pool (%d)!", res);
@@ -434,27 +898,47 @@ static int esp32_apptrace_block_free(struct esp32_apptrace_cmd_ctx *ctx,
 	return res;
 }
 
+static uint32_t esp32_apptrace_ready_blocks_num(struct esp32_apptrace_cmd_ctx *ctx)
+{
+	uint32_t num = 0;
+
+	if (pthread_mutex_lock(&ctx->trax_blocks_mux) == 0) {
+		num = ctx->ready_trax_blocks.count;
+		pthread_mutex_unlock(&ctx->trax_blocks_mux);
+	}
+	return num;
+}
+
+/* Stops data processor thread and waits for it to exit */
+static void esp32_apptrace_data_processor_stop(struct esp32_apptrace_cmd_ctx *ctx)
+{
+	if (ctx->data_processor == (pthread_t)-1)
+		return;
+	pthread_mutex_lock(&ctx->trax_blocks_mux);
+	ctx->running = 0;
+	pthread_cond_signal(&ctx->trax_blocks_ready);
+	pthread_mutex_unlock(&ctx->trax_blocks_mux);
+	void *thr_res;
+	int res = pthread_join(ctx->data_processor, (void *)&thr_res);
+	if (res)
+		LOG_ERROR("Failed to join trace data processor thread (%d)!", res);
+	else
+		LOG_INFO("Trace data processor thread exited with %ld", (long)thr_res);
+	ctx->data_processor = (pthread_t)-1;
+}
+
 static int esp32_apptrace_wait_tracing_finished(struct esp32_apptrace_cmd_ctx *ctx)
 {
 	int i = 0, tries = LOG_LEVEL_IS(LOG_LVL_DEBUG) ? 700 : 50;
-	while (!hlist_empty(&ctx->ready_trax_blocks)) {
+	while (esp32_apptrace_ready_blocks_num(ctx)) {
 		alive_sleep(100);
 		if (i++ == tries) {
 			LOG_ERROR("Failed to wait for pended TRAX blocks!");
 			return ERROR_FAIL;
 		}
 	}
-	/* signal thread to stop */
-	ctx->running = 0;
-	/* wait for the processor thread to finish */
-	if (ctx->data_processor != (pthread_t)-1) {
-		void *thr_res;
-		int res = pthread_join(ctx->data_processor, (void *)&thr_res);
-		if (res)
-			LOG_ERROR("Failed to join trace data processor thread (%d)!", res);
-		else
-			LOG_INFO("Trace data processor thread exited with %ld", (long)thr_res);
-	}
+	/* signal thread to stop and wait for it to finish */
+	esp32_apptrace_data_processor_stop(ctx);
 
 	return ERROR_OK;
 }
@@ -532,8 +1016,6 @@ static int esp32_apptrace_cmd_ctx_init(struct target *target,
 		trace_config.memaddr_end,
 		trace_config.addr);
 
-	INIT_HLIST_HEAD(&cmd_ctx->ready_trax_blocks);
-	INIT_HLIST_HEAD(&cmd_ctx->free_trax_blocks);
 	for (int i = 0; i < ESP_APPTRACE_BLOCKS_POOL_SZ; i++) {
 		struct esp32_apptrace_block *block = malloc(sizeof(struct esp32_apptrace_block));
 		if (!block) {
@@ -548,8 +1030,7 @@ static int esp32_apptrace_cmd_ctx_init(struct target *target,
 			esp32_apptrace_blocks_pool_cleanup(cmd_ctx);
 			return ERROR_FAIL;
 		}
-		INIT_HLIST_NODE(&block->node);
-		hlist_add_head(&block->node, &cmd_ctx->free_trax_blocks);
+		esp32_apptrace_block_enqueue(&cmd_ctx->free_trax_blocks, block);
 	}
 
 	cmd_ctx->running = 1;
@@ -560,6 +1041,13 @@ static int esp32_apptrace_cmd_ctx_init(struct target *target,
 		esp32_apptrace_blocks_pool_cleanup(cmd_ctx);
 		return ERROR_FAIL;
 	}
+	res = pthread_cond_init(&cmd_ctx->trax_blocks_ready, NULL);
+	if (res) {
+		LOG_ERROR("Failed to init blocks pool cond (%d)!", res);
+		pthread_mutex_destroy(&cmd_ctx->trax_blocks_mux);
+		esp32_apptrace_blocks_pool_cleanup(cmd_ctx);
+		return ERROR_FAIL;
+	}
 	if (cmd_ctx->mode != ESP_APPTRACE_CMD_MODE_SYNC) {
 		res = pthread_create(&cmd_ctx->data_processor,
 			NULL,
@@ -568,6 +1056,7 @@ static int esp32_apptrace_cmd_ctx_init(struct target *target,
 		if (res) {
 			LOG_ERROR("Failed to start trace data processor thread (%d)!", res);
 			cmd_ctx->data_processor = (pthread_t)-1;
+			pthread_cond_destroy(&cmd_ctx->trax_blocks_ready);
 			pthread_mutex_destroy(&cmd_ctx->trax_blocks_mux);
 			esp32_apptrace_blocks_pool_cleanup(cmd_ctx);
 			return ERROR_FAIL;
@@ -589,6 +1078,9 @@ static int esp32_apptrace_cmd_ctx_init(struct target *target,
 
 static int esp32_apptrace_cmd_ctx_cleanup(struct esp32_apptrace_cmd_ctx *cmd_ctx)
 {
+	/* processor thread may still wait for data if tracing was stopped due to error */
+	esp32_apptrace_data_processor_stop(cmd_ctx);
+	pthread_cond_destroy(&cmd_ctx->trax_blocks_ready);
 	pthread_mutex_destroy(&cmd_ctx->trax_blocks_mux);
 	esp32_apptrace_blocks_pool_cleanup(cmd_ctx);
 	return ERROR_OK;
@@ -640,7 +1132,8 @@ static int esp32_apptrace_cmd_init(struct target *target,
 	cmd_data->poll_period = 1 /*ms*/;
 	int dests_num = esp32_apptrace_dest_init(cmd_data->data_dests,
 		argv,
-		cmd_ctx->mode == ESP_APPTRACE_CMD_MODE_SYSVIEW ? cmd_ctx->cores_num : 1);
+		cmd_ctx->mode == ESP_APPTRACE_CMD_MODE_SYSVIEW ? cmd_ctx->cores_num : 1,
+		cmd_ctx->mode != ESP_APPTRACE_CMD_MODE_SYNC);
 	if (cmd_ctx->mode == ESP_APPTRACE_CMD_MODE_SYSVIEW && dests_num < cmd_ctx->cores_num) {
 		LOG_ERROR("Not enough args! Need %d trace data destinations!", cmd_ctx->cores_num);
 		res = ERROR_FAIL;
@@ -696,6 +1189,7 @@ static int esp32_apptrace_cmd_cleanup(struct esp32_apptrace_cmd_ctx *cmd_ctx)
 	struct esp32_apptrace_cmd_data *cmd_data = cmd_ctx->cmd_priv;
 
 	esp32_apptrace_dest_cleanup(cmd_data->data_dests, cmd_ctx->cores_num);
+	free(cmd_data->sv_pkt_buf);
 	free(cmd_data);
 	esp32_apptrace_cmd_ctx_cleanup(cmd_ctx);
 	memset(cmd_ctx, 0, sizeof(*cmd_ctx));
@@ -707,18 +1201,26 @@ static void esp32_apptrace_print_stats(struct esp32_apptrace_cmd_ctx *ctx)
 	struct esp32_apptrace_cmd_data *cmd_data = ctx->cmd_priv;
 	uint32_t trace_sz = 0;
 
-	if (cmd_data)
+	if (cmd_data) {
 		trace_sz = ctx->tot_len >
 			cmd_data->skip_len ? ctx->tot_len - cmd_data->skip_len : 0;
+		ctx->stats.dropped_bytes = 0;
+		for (int i = 0; i < ESP_APPTRACE_MAX_CORES_NUM; i++) {
+			if (cmd_data->data_dests[i].dropped)
+				ctx->stats.dropped_bytes +=
+					cmd_data->data_dests[i].dropped(cmd_data->data_dests[i].priv);
+		}
+	}
 	LOG_USER("Tracing is %s. Size is %u of %u @ %f (%f) KB/s",
 		!ctx->running ? "STOPPED" : "RUNNING",
 		trace_sz,
 		cmd_data ? cmd_data->max_len : 0,
 		duration_kbps(&ctx->read_time, ctx->tot_len),
 		duration_kbps(&ctx->read_time, ctx->raw_tot_len));
-	LOG_USER("Data: blocks incomplete %u, lost bytes: %u",
+	LOG_USER("Data: blocks incomplete %u, lost bytes: %u, dropped bytes: %u",
 		ctx->stats.incompl_blocks,
-		ctx->stats.lost_bytes);
+		ctx->stats.lost_bytes,
+		ctx->stats.dropped_bytes);
 #if ESP_APPTRACE_TIME_STATS_ENABLE
 	LOG_USER("TRAX: block read time [%f..%f] ms",
 		1000*ctx->stats.min_blk_read_time,
@@ -1347,6 +1849,33 @@ static uint16_t esp_sysview_parse_packet(uint8_t *pkt_buf,
 	return event_id;
 }
 
+/* Writes packet body followed by re-encoded time delta to the destination in one call,
+ * so destinations which drop data when they can not keep up never drop part of the packet */
+static int esp32_sysview_write_packet(struct esp32_apptrace_cmd_data *cmd_data,
+	int dest_id,
+	uint8_t *pkt,
+	uint32_t pkt_len,
+	uint8_t *delta,
+	uint32_t delta_len)
+{
+	struct esp32_apptrace_dest *dest = &cmd_data->data_dests[dest_id];
+
+	if (delta_len == 0)
+		return dest->write(dest->priv, pkt, pkt_len);
+	if (pkt_len + delta_len > cmd_data->sv_pkt_buf_sz) {
+		uint8_t *buf = realloc(cmd_data->sv_pkt_buf, pkt_len + delta_len);
+		if (!buf) {
+			LOG_ERROR("SEGGER: Failed to alloc %u bytes for packet!", pkt_len + delta_len);
+			return ERROR_FAIL;
+		}
+		cmd_data->sv_pkt_buf = buf;
+		cmd_data->sv_pkt_buf_sz = pkt_len + delta_len;
+	}
+	memcpy(cmd_data->sv_pkt_buf, pkt, pkt_len);
+	memcpy(cmd_data->sv_pkt_buf + pkt_len, delta, delta_len);
+	return dest->write(dest->priv, cmd_data->sv_pkt_buf, pkt_len + delta_len);
+}
+
 static int esp32_sysview_process_data(struct esp32_apptrace_cmd_ctx *ctx,
 	int core_id,
 	uint8_t *data,
@@ -1448,28 +1977,19 @@ static int esp32_sysview_process_data(struct esp32_apptrace_cmd_ctx *ctx,
 			processed += pkt_len;
 			continue;
 		}
-		res = cmd_data->data_dests[pkt_core_id].write(
-			cmd_data->data_dests[pkt_core_id].priv,
+		/* write packet with modified delta if any */
+		res = esp32_sysview_write_packet(cmd_data,
+			pkt_core_id,
 			data + processed,
-			wr_len);
+			wr_len,
+			new_delta_buf,
+			new_delta_len);
 		if (res != ERROR_OK) {
-			LOG_ERROR("SEGGER: Failed to write %u bytes to dest %d!", wr_len, core_id);
+			LOG_ERROR("SEGGER: Failed to write %u bytes to dest %d!",
+				wr_len + new_delta_len,
+				core_id);
 			return res;
 		}
-		if (new_delta_len) {
-			/* write packet with modified delta */
-			res =
-				cmd_data->data_dests[pkt_core_id].write(
-				cmd_data->data_dests[pkt_core_id].priv,
-				new_delta_buf,
-				new_delta_len);
-			if (res != ERROR_OK) {
-				LOG_ERROR("SEGGER: Failed to write %u bytes of delta to dest %d!",
-					new_delta_len,
-					core_id);
-				return res;
-			}
-		}
 		if (ctx->cores_num > 1) {
 			/* handle other core dest */
 			int other_core_id = pkt_core_id ? 0 : 1;
@@ -1508,31 +2028,19 @@ static int esp32_sysview_process_data(struct esp32_apptrace_cmd_ctx *ctx,
 					wr_len,
 					event_id,
 					other_core_id);
-					res = cmd_data->data_dests[other_core_id].write(
-					cmd_data->data_dests[other_core_id].priv,
+					res = esp32_sysview_write_packet(cmd_data,
+					other_core_id,
 					data + processed,
-					wr_len);
+					wr_len,
+					new_delta_buf,
+					new_delta_len);
 					if (res != ERROR_OK) {
 						LOG_ERROR(
 						"SEGGER: Failed to write %u bytes to dest %d!",
-						wr_len,
+						wr_len + new_delta_len,
 						other_core_id);
 						return res;
 					}
-					if (new_delta_len) {
-						/* write packet with modified delta */
-						res = cmd_data->data_dests[other_core_id].write(
-						cmd_data->data_dests[other_core_id].priv,
-						new_delta_buf,
-						new_delta_len);
-						if (res != ERROR_OK) {
-							LOG_ERROR(
-							"SEGGER: Failed to write %u bytes of delta to dest %d!",
-							new_delta_len,
-							other_core_id);
-							return res;
-						}
-					}
 					/* messages above are cloned to trace files for both cores,
 					 * so reset acc time delta, both files have actual delta
 					 * info */
@@ -1601,7 +2109,7 @@ static void *esp32_apptrace_data_processor(void *arg)
 	while (ctx->running) {
 		struct esp32_apptrace_block *block = esp32_apptrace_ready_block_get(ctx);
 		if (!block)
-			continue;
+			break;
 		res = esp32_apptrace_handle_trace_block(ctx, block);
 		if (res != ERROR_OK) {
 			ctx->running = 0;
@@ -2176,8 +2684,11 @@ static int esp_gcov_fopen(struct esp32_gcov_cmd_data *cmd_data,
 		if (errno != ENOENT || strchr(mode, 'r') == NULL)
 			LOG_ERROR("Failed to open file '%s', mode '%s' (%d)!", fname, mode, errno);
 		fd = 0;
-	} else
+	} else {
+		/* gcov data are written in many small chunks */
+		setvbuf(cmd_data->files[fd], NULL, _IOFBF, ESP_GCOV_FILE_BUF_SZ);
 		fd++;	/* 1-based, 0 indicates error */
+	}
 
 	*resp_len = sizeof(fd);
 	*resp = malloc(*resp_len);
@@ -2392,50 +2903,179 @@ static int esp_gcov_ftell(struct esp32_gcov_cmd_data *cmd_data,
 	return ERROR_OK;
 }
 
-/*TODO: support for multi-block data transfers */
-static int esp_gcov_process_data(struct esp32_apptrace_cmd_ctx *ctx,
-	int core_id,
+static int esp_gcov_cmd_exec(struct esp32_apptrace_cmd_ctx *ctx,
+	uint8_t cmd,
 	uint8_t *data,
-	uint32_t data_len)
+	uint32_t data_len,
+	uint8_t **resp,
+	uint32_t *resp_len)
 {
-	int ret = ERROR_OK;
 	struct esp32_gcov_cmd_data *cmd_data = ctx->cmd_priv;
-	uint8_t *resp;
-	uint32_t resp_len = 0;
-
-	LOG_DEBUG("Got block %d bytes [%x %x]", data_len, data[0], data[1]);
 
-	if (data_len < 1) {
-		LOG_ERROR("Too small data length %d!", data_len);
-		return ERROR_FAIL;
-	}
-
-	switch (*data) {
+	*resp_len = 0;
+	switch (cmd) {
 		case ESP_APPTRACE_FILE_CMD_FOPEN:
-			ret = esp_gcov_fopen(cmd_data, data+1, data_len-1, &resp, &resp_len);
-			break;
+			return esp_gcov_fopen(cmd_data, data, data_len, resp, resp_len);
 		case ESP_APPTRACE_FILE_CMD_FCLOSE:
-			ret = esp_gcov_fclose(cmd_data, data+1, data_len-1, &resp, &resp_len);
-			break;
+			return esp_gcov_fclose(cmd_data, data, data_len, resp, resp_len);
 		case ESP_APPTRACE_FILE_CMD_FWRITE:
-			ret = esp_gcov_fwrite(cmd_data, data+1, data_len-1, &resp, &resp_len);
-			break;
+			return esp_gcov_fwrite(cmd_data, data, data_len, resp, resp_len);
 		case ESP_APPTRACE_FILE_CMD_FREAD:
-			ret = esp_gcov_fread(cmd_data, data+1, data_len-1, &resp, &resp_len);
-			break;
+			return esp_gcov_fread(cmd_data, data, data_len, resp, resp_len);
 		case ESP_APPTRACE_FILE_CMD_FSEEK:
-			ret = esp_gcov_fseek(cmd_data, data+1, data_len-1, &resp, &resp_len);
-			break;
+			return esp_gcov_fseek(cmd_data, data, data_len, resp, resp_len);
 		case ESP_APPTRACE_FILE_CMD_FTELL:
-			ret = esp_gcov_ftell(cmd_data, data+1, data_len-1, &resp, &resp_len);
-			break;
+			return esp_gcov_ftell(cmd_data, data, data_len, resp, resp_len);
 		case ESP_APPTRACE_FILE_CMD_STOP:
 			ctx->running = 0;
-			break;
+			return ERROR_OK;
 		default:
-			LOG_ERROR("Invalid FCMD 0x%x!", *data);
-			ret = ERROR_FAIL;
+			LOG_ERROR("Invalid FCMD 0x%x!", cmd);
+			return ERROR_FAIL;
+	}
+}
+
+/* Executes all commands of the batch and combines their responses into one buffer.
+ * Failure of the command is reported in the response, error is returned only if no response can be sent. */
+static int esp_gcov_batch_exec(struct esp32_apptrace_cmd_ctx *ctx,
+	uint8_t *data,
+	uint32_t data_len,
+	uint8_t **resp,
+	uint32_t *resp_len)
+{
+	struct esp32_gcov_cmd_data *cmd_data = ctx->cmd_priv;
+	const uint32_t cmd_hdr_sz = sizeof(uint8_t) + sizeof(uint32_t);
+	uint32_t status = ESP_GCOV_BATCH_STATUS_OK;
+	uint32_t processed = 0, cmds_num = 0;
+	/* file descs returned by FOPENs of this batch, 0 for failed ones */
+	uint32_t *opened_fds = NULL;
+	uint32_t opened_num = 0;
+	uint32_t batch_resp_len = sizeof(status) + sizeof(cmds_num);
+	uint8_t *batch_resp = malloc(batch_resp_len);
+
+	if (!batch_resp) {
+		LOG_ERROR("Failed to alloc mem for resp!");
+		return ERROR_FAIL;
+	}
+
+	while (processed < data_len) {
+		if (data_len - processed < cmd_hdr_sz) {
+			LOG_ERROR("Truncated FCMD header in batch!");
+			status = ESP_GCOV_BATCH_STATUS_INVALID;
+			break;
+		}
+		uint8_t cmd = data[processed];
+		uint32_t args_len;
+		memcpy(&args_len, data + processed + sizeof(cmd), sizeof(args_len));
+		processed += cmd_hdr_sz;
+		if (args_len > data_len - processed) {
+			LOG_ERROR("Truncated FCMD 0x%x args in batch (%u > %u)!", cmd, args_len,
+				data_len - processed);
+			status = ESP_GCOV_BATCH_STATUS_INVALID;
+			break;
+		}
+		if (cmd == ESP_APPTRACE_FILE_CMD_BATCH) {
+			LOG_ERROR("Nested FCMD batch!");
+			status = ESP_GCOV_BATCH_STATUS_INVALID;
+			break;
+		}
+		if (cmd == ESP_APPTRACE_FILE_CMD_STOP && processed + args_len != data_len) {
+			LOG_ERROR("FCMD STOP is not the last one in batch!");
+			status = ESP_GCOV_BATCH_STATUS_INVALID;
+			break;
+		}
+		uint8_t *args = data + processed;
+		if (cmd != ESP_APPTRACE_FILE_CMD_FOPEN && cmd != ESP_APPTRACE_FILE_CMD_STOP &&
+			args_len >= sizeof(uint32_t)) {
+			uint32_t fd;
+			memcpy(&fd, args, sizeof(fd));
+			if (fd & ESP_GCOV_BATCH_FD_REF) {
+				uint32_t idx = fd & ~ESP_GCOV_BATCH_FD_REF;
+				if (idx >= opened_num || opened_fds[idx] == 0) {
+					LOG_ERROR("Invalid file desc reference to FOPEN %u in batch!", idx);
+					status = ESP_GCOV_BATCH_STATUS_INVALID;
+					break;
+				}
+				memcpy(args, &opened_fds[idx], sizeof(opened_fds[idx]));
+			}
+		}
+
+		uint8_t *cmd_resp;
+		uint32_t cmd_resp_len;
+		int res = esp_gcov_cmd_exec(ctx, cmd, args, args_len, &cmd_resp, &cmd_resp_len);
+		if (res != ERROR_OK) {
+			status = ESP_GCOV_BATCH_STATUS_CMD_FAILED;
+			break;
+		}
+		processed += args_len;
+		if (cmd == ESP_APPTRACE_FILE_CMD_FOPEN) {
+			uint32_t *fds = realloc(opened_fds, (opened_num + 1) * sizeof(*fds));
+			if (!fds) {
+				LOG_ERROR("Failed to alloc mem for batch file descs!");
+				free(cmd_resp);
+				status = ESP_GCOV_BATCH_STATUS_NO_MEM;
+				break;
+			}
+			opened_fds = fds;
+			memcpy(&opened_fds[opened_num++], cmd_resp, sizeof(*fds));
+		}
+		if (cmd_resp_len != 0) {
+			uint8_t *new_resp = realloc(batch_resp, batch_resp_len + cmd_resp_len);
+			if (!new_resp) {
+				LOG_ERROR("Failed to alloc mem for resp!");
+				free(cmd_resp);
+				status = ESP_GCOV_BATCH_STATUS_NO_MEM;
+				break;
+			}
+			batch_resp = new_resp;
+			memcpy(batch_resp + batch_resp_len, cmd_resp, cmd_resp_len);
+			batch_resp_len += cmd_resp_len;
+			free(cmd_resp);
+		}
+		cmds_num++;
+	}
+
+	if (status != ESP_GCOV_BATCH_STATUS_OK) {
+		LOG_ERROR("FCMD batch failed after %u commands (%u)!", cmds_num, status);
+		/* target discards the whole batch, so do not leave its files open */
+		for (uint32_t i = 0; i < opened_num; i++) {
+			if (opened_fds[i] == 0 || !cmd_data->files[opened_fds[i] - 1])
+				continue;
+			fclose(cmd_data->files[opened_fds[i] - 1]);
+			cmd_data->files[opened_fds[i] - 1] = NULL;
+		}
+	}
+	free(opened_fds);
+	LOG_DEBUG("Processed batch of %u FCMDs, resp %u bytes", cmds_num, batch_resp_len);
+
+	memcpy(batch_resp, &status, sizeof(status));
+	memcpy(batch_resp + sizeof(status), &cmds_num, sizeof(cmds_num));
+	*resp = batch_resp;
+	*resp_len = batch_resp_len;
+	return ERROR_OK;
+}
+
+/*TODO: support for multi-block data transfers */
+static int esp_gcov_process_data(struct esp32_apptrace_cmd_ctx *ctx,
+	int core_id,
+	uint8_t *data,
+	uint32_t data_len)
+{
+	int ret;
+	uint8_t *resp;
+	uint32_t resp_len = 0;
+
+	if (data_len < 1) {
+		LOG_ERROR("Too small data length %d!", data_len);
+		return ERROR_FAIL;
 	}
+
+	LOG_DEBUG("Got block %d bytes [%x %x]", data_len, data[0], data[1]);
+
+	if (*data == ESP_APPTRACE_FILE_CMD_BATCH)
+		ret = esp_gcov_batch_exec(ctx, data+1, data_len-1, &resp, &resp_len);
+	else
+		ret = esp_gcov_cmd_exec(ctx, *data, data+1, data_len-1, &resp, &resp_len);
 	if (ret != ERROR_OK)
 		return ret;
 
@@ -2580,7 +3220,7 @@ const struct command_registration esp32_apptrace_command_handlers[] = {
 		.help =
 			"App Tracing: application level trace control. Starts, stops or queries tracing process status.",
 		.usage =
-			"[start file://<outfile> [poll_period [trace_size [stop_tmo [wait4halt [skip_size]]]]] | [stop] | [status] | [dump file://<outfile>]",
+			"[start <file://<outfile>|tcp://[host]:port> [poll_period [trace_size [stop_tmo [wait4halt [skip_size]]]]] | [stop] | [status] | [dump file://<outfile>]",
 	},
 	{
 		.name = "sysview",
@@ -2589,7 +3229,7 @@ const struct command_registration esp32_apptrace_command_handlers[] = {
 		.help =
 			"App Tracing: SEGGER SystemView compatible trace control. Starts, stops or queries tracing process status.",
 		.usage =
-			"[start file://<outfile1> [file://<outfile2>] [poll_period [trace_size [stop_tmo [wait4halt [skip_size]]]]] | [stop] | [status]",
+			"[start <file://<outfile1>|tcp://[host]:port> [<file://<outfile2>|tcp://[host]:port>] [poll_period [trace_size [stop_tmo [wait4halt [skip_size]]]]] | [stop] | [status]",
 	},
 	{
 		.name = "gcov",
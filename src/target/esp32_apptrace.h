@@ -24,6 +24,34 @@
 
 #include "command.h"
 
+/* File commands sent by target's gcov code over apptrace. Request is 1-byte command ID followed by
+ * its args, response is sent back via down buffer. */
+#define ESP_APPTRACE_FILE_CMD_FOPEN     0x0
+#define ESP_APPTRACE_FILE_CMD_FCLOSE    0x1
+#define ESP_APPTRACE_FILE_CMD_FWRITE    0x2
+#define ESP_APPTRACE_FILE_CMD_FREAD     0x3
+#define ESP_APPTRACE_FILE_CMD_FSEEK     0x4
+#define ESP_APPTRACE_FILE_CMD_FTELL     0x5
+#define ESP_APPTRACE_FILE_CMD_STOP      0x6	/* indicates that there is no files to transfer */
+/* Many commands in one block. Request layout (all fields are little-endian):
+ *   [u8 ESP_APPTRACE_FILE_CMD_BATCH]
+ *   N x [u8 cmd ID][u32 args_len][args_len bytes of args]
+ * Response layout:
+ *   [u32 status, one of ESP_GCOV_BATCH_STATUS_xxx][u32 number of executed commands]
+ *   [concatenated responses of the executed commands]
+ * Execution stops at the first failed command, files opened by the failed batch are closed.
+ * Nested batches are not allowed, STOP is allowed as the last command only. */
+#define ESP_APPTRACE_FILE_CMD_BATCH     0x7
+/* file desc arg of a batched command with this bit set refers to the file opened by the N-th FOPEN
+ * of the same batch, N (0-based) is in the lower bits */
+#define ESP_GCOV_BATCH_FD_REF           0x80000000U
+
+/* batch response status */
+#define ESP_GCOV_BATCH_STATUS_OK            0	/* all commands have been executed */
+#define ESP_GCOV_BATCH_STATUS_CMD_FAILED    1	/* command has failed, e.g. file can not be opened */
+#define ESP_GCOV_BATCH_STATUS_INVALID       2	/* malformed batch or invalid file desc reference */
+#define ESP_GCOV_BATCH_STATUS_NO_MEM        3	/* host has run out of memory */
+
 extern const struct command_registration esp32_apptrace_command_handlers[];
 
 #endif	/* ESP32_APPTRACE_H */
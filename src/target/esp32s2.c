@@ -410,6 +410,16 @@ static bool esp32_s2_on_halt(struct target *target)
 	return esp_xtensa_on_halt(target);
 }
 
+static bool esp32_s2_on_fast_halt(struct target *target)
+{
+	if (!esp_xtensa_semihost_pending(target))
+		return false;
+	int ret = esp32_s2_disable_wdts(target);
+	if (ret != ERROR_OK)
+		return false;
+	return esp_xtensa_do_semihosting(target) == ERROR_OK;
+}
+
 static int esp32_s2_virt2phys(struct target *target,
 	target_addr_t virtual, target_addr_t *physical)
 {
@@ -445,6 +455,7 @@ static const struct xtensa_chip_ops esp32_s2_chip_ops = {
 	.on_reset = esp_xtensa_on_reset,
 	.on_poll = esp_xtensa_on_poll,
 	.on_halt = esp32_s2_on_halt,
+	.on_fast_halt = esp32_s2_on_fast_halt,
 };
 
 static int esp32_s2_target_create(struct target *target, Jim_Interp *interp)
@@ -533,6 +544,7 @@ struct target_type esp32_s2_target = {
 	.write_buffer = xtensa_write_buffer,
 
 	.checksum_memory = xtensa_checksum_memory,
+	.profiling = xtensa_profiling,
 
 	.get_gdb_reg_list = xtensa_get_gdb_reg_list,
 
@@ -25,6 +25,7 @@
 #include "esp_xtensa.h"
 #include "xtensa_mcore.h"
 #include "esp_xtensa_apptrace.h"
+#include <helper/time_support.h>
 
 #define ESP_XTENSA_SYSCALL     XT_INS_BREAK(1,1)
 #define ESP_XTENSA_SYSCALL_SZ  3
@@ -37,6 +38,9 @@
 
 #define ESP_FD_MIN          2
 
+/* Max size of data moved between target memory and file per one step of read/write syscalls */
+#define ESP_SEMIHOST_CHUNK_SZ   (64*1024)
+
 #define ESP_O_RDONLY        0
 #define ESP_O_WRONLY        1
 #define ESP_O_RDWR          2
@@ -70,7 +74,6 @@
 
 static void esp_xtensa_dbgstubs_info_update(struct target *target);
 static void esp_xtensa_dbgstubs_addr_check(struct target *target);
-static int esp_xtensa_do_semihosting(struct target *target);
 
 
 static int esp_xtensa_dbgstubs_restore(struct target *target)
@@ -260,27 +263,36 @@ void esp_xtensa_on_poll(struct target *target)
 		esp_xtensa_dbgstubs_addr_check(target);
 }
 
-bool esp_xtensa_on_halt(struct target *target)
+/* Checks whether the target has been halted by semihosting call. Only DEBUGCAUSE and PC are used,
+ * so it can be called before the full register fetch. */
+bool esp_xtensa_semihost_pending(struct target *target)
 {
-	int res;
+	uint8_t brk_insn_buf[sizeof(uint32_t)] = {0};
 
 	xtensa_reg_val_t dbg_cause = xtensa_reg_get(target, XT_REG_IDX_DEBUGCAUSE);
-	if (dbg_cause & (DEBUGCAUSE_BI|DEBUGCAUSE_BN)) {
-		uint8_t brk_insn_buf[sizeof(uint32_t)] = {0};
-		xtensa_reg_val_t pc = xtensa_reg_get(target, XT_REG_IDX_PC);
-		res = target_read_memory(target,
-			pc,
-			ESP_XTENSA_SYSCALL_SZ,
-			1,
-			(uint8_t *)brk_insn_buf);
-		if (res != ERROR_OK)
-			LOG_ERROR("Failed to read break instruction!");
-		else if (buf_get_u32(brk_insn_buf, 0, 32) == ESP_XTENSA_SYSCALL) {
-			if (esp_xtensa_do_semihosting(target) == ERROR_OK)
-				return true;
-		}
+	if ((dbg_cause & (DEBUGCAUSE_BI|DEBUGCAUSE_BN)) == 0)
+		return false;
+	xtensa_reg_val_t pc = xtensa_reg_get(target, XT_REG_IDX_PC);
+	int res = target_read_memory(target,
+		pc,
+		ESP_XTENSA_SYSCALL_SZ,
+		1,
+		(uint8_t *)brk_insn_buf);
+	if (res != ERROR_OK) {
+		LOG_ERROR("Failed to read break instruction!");
+		return false;
 	}
-	return false;
+	return buf_get_u32(brk_insn_buf, 0, 32) == ESP_XTENSA_SYSCALL;
+}
+
+bool esp_xtensa_on_halt(struct target *target)
+{
+	/* semihosting call has already been looked for on fast halt, do not read the break insn again */
+	if (target_to_xtensa(target)->fast_halt_done)
+		return false;
+	if (!esp_xtensa_semihost_pending(target))
+		return false;
+	return esp_xtensa_do_semihosting(target) == ERROR_OK;
 }
 
 static void esp_xtensa_dbgstubs_addr_check(struct target *target)
@@ -441,12 +453,134 @@ void esp_xtensa_queue_tdi_idle(struct target *target)
 	/*Scan out 1 bit, do not move from IRPAUSE after we're done. */
 	buf_set_u32(t, 0, 1, value);
 	jtag_add_plain_ir_scan(1, t, NULL, TAP_IRPAUSE);
+	/* IR is corrupted by partial scan above */
+	xtensa_dm_ir_cache_invalidate();
+}
+
+static const char *esp_xtensa_semihost_syscall_name(unsigned int id)
+{
+	switch (id) {
+		case ESP_SYS_OPEN:
+			return "open";
+		case ESP_SYS_CLOSE:
+			return "close";
+		case ESP_SYS_WRITE:
+			return "write";
+		case ESP_SYS_READ:
+			return "read";
+		case ESP_SYS_SEEK:
+			return "seek";
+		default:
+			return "unknown";
+	}
+}
+
+static void esp_xtensa_semihost_stats_update(struct esp_xtensa_semihost_data *semihost,
+	xtensa_reg_val_t id,
+	struct duration *dur)
+{
+	struct esp_xtensa_semihost_stats *stats =
+		&semihost->stats[id < ESP_XTENSA_SEMIHOST_SYSCALLS_NUM ? id : 0];
+
+	if (duration_measure(dur) != 0)
+		return;
+	uint32_t us = dur->elapsed.tv_sec * 1000000 + dur->elapsed.tv_usec;
+	stats->count++;
+	stats->total_us += us;
+	if (us > stats->max_us)
+		stats->max_us = us;
+}
+
+/* Moves data from target memory to the file in chunks to keep host memory usage bounded.
+ * Returns the number of bytes written or -1 and sets 'err' if nothing could be written. */
+static int esp_xtensa_semihost_write(struct target *target,
+	int fd,
+	target_addr_t addr,
+	uint32_t size,
+	int *err)
+{
+	uint32_t done = 0;
+	uint8_t *buf = malloc(MIN(size, ESP_SEMIHOST_CHUNK_SZ));
+
+	if (!buf) {
+		*err = ENOMEM;
+		return -1;
+	}
+	*err = 0;
+	while (done < size) {
+		uint32_t len = MIN(size - done, ESP_SEMIHOST_CHUNK_SZ);
+		int retval = target_read_buffer(target, addr + done, len, buf);
+		if (retval != ERROR_OK) {
+			*err = EINVAL;
+			break;
+		}
+		ssize_t wr = write(fd, buf, len);
+		if (wr < 0) {
+			*err = errno;
+			break;
+		}
+		done += wr;
+		if ((uint32_t)wr < len)
+			break;
+	}
+	free(buf);
+	if (done == 0 && *err != 0)
+		return -1;
+	return done;
+}
+
+/* Moves data from the file to target memory in chunks to keep host memory usage bounded.
+ * Stops on a short read from the file as read() does.
+ * Returns the number of bytes stored to target memory or -1 and sets 'err' if nothing could be stored. */
+static int esp_xtensa_semihost_read(struct target *target,
+	int fd,
+	target_addr_t addr,
+	uint32_t size,
+	int *err)
+{
+	uint32_t done = 0;
+	uint8_t *buf = malloc(MIN(size, ESP_SEMIHOST_CHUNK_SZ));
+
+	if (!buf) {
+		*err = ENOMEM;
+		return -1;
+	}
+	*err = 0;
+	while (done < size) {
+		uint32_t len = MIN(size - done, ESP_SEMIHOST_CHUNK_SZ);
+		ssize_t rd = read(fd, buf, len);
+		if (rd < 0) {
+			*err = errno;
+			break;
+		}
+		if (rd == 0)
+			break;
+		int retval = target_write_buffer(target, addr + done, rd, buf);
+		if (retval != ERROR_OK) {
+			/* put back the chunk which has not been stored, so the file position
+			 * matches the number of bytes reported as read */
+			if (lseek(fd, -rd, SEEK_CUR) < 0)
+				LOG_WARNING("Failed to rewind file %d after target write error!", fd);
+			*err = EINVAL;
+			break;
+		}
+		done += rd;
+		if ((uint32_t)rd < len)
+			break;
+	}
+	free(buf);
+	if (done == 0 && *err != 0)
+		return -1;
+	return done;
 }
 
-static int esp_xtensa_do_semihosting(struct target *target)
+int esp_xtensa_do_semihosting(struct target *target)
 {
 	struct esp_xtensa_common *esp_xtensa = target_to_esp_xtensa(target);
 	int syscall_ret = 0, syscall_errno = 0, retval;
+	/* latency is counted from the halt detection, so it includes register reads */
+	struct duration dur = { .start = esp_xtensa->xtensa.halt_time };
+
 	/* TODO: use a2, a3, a4, a5, a6 for syscall params when problem with a3 corruption will be
 	 * solved */
 	xtensa_reg_val_t a2 = xtensa_reg_get(target, XT_REG_IDX_A2);
@@ -554,23 +688,8 @@ static int esp_xtensa_do_semihosting(struct target *target)
 				syscall_errno = 0;
 				break;
 			}
-			uint8_t *buf = malloc(a5);
-			if (!buf) {
-				syscall_ret = -1;
-				syscall_errno = ENOMEM;
-				break;
-			}
-			retval = target_read_buffer(target, a4, a5, buf);
-			if (retval != ERROR_OK) {
-				free(buf);
-				syscall_ret = -1;
-				syscall_errno = EINVAL;
-				break;
-			}
-			syscall_ret = write(a3, buf, a5);
-			syscall_errno = errno;
-			LOG_DEBUG("Wrote file %d. %d bytes.", a3, a5);
-			free(buf);
+			syscall_ret = esp_xtensa_semihost_write(target, a3, a4, a5, &syscall_errno);
+			LOG_DEBUG("Wrote file %d. %d bytes.", a3, syscall_ret);
 			break;
 		}
 		case ESP_SYS_READ:
@@ -588,25 +707,8 @@ static int esp_xtensa_do_semihosting(struct target *target)
 				syscall_errno = 0;
 				break;
 			}
-			uint8_t *buf = malloc(a5);
-			if (!buf) {
-				syscall_ret = -1;
-				syscall_errno = ENOMEM;
-				break;
-			}
-			syscall_ret = read(a3, buf, a5);
-			syscall_errno = errno;
-			LOG_DEBUG("Read file %d. %d bytes.", a3, a5);
-			if (syscall_ret >= 0) {
-				retval = target_write_buffer(target, a4, syscall_ret, buf);
-				if (retval != ERROR_OK) {
-					free(buf);
-					syscall_ret = -1;
-					syscall_errno = EINVAL;
-					break;
-				}
-			}
-			free(buf);
+			syscall_ret = esp_xtensa_semihost_read(target, a3, a4, a5, &syscall_errno);
+			LOG_DEBUG("Read file %d. %d bytes.", a3, syscall_ret);
 			break;
 		}
 		case ESP_SYS_SEEK:
@@ -632,6 +734,7 @@ static int esp_xtensa_do_semihosting(struct target *target)
 
 	xtensa_reg_set(target, SYSCALL_RETVAL_REG, syscall_ret);
 	xtensa_reg_set(target, SYSCALL_PARAM2_REG, syscall_errno);
+	esp_xtensa_semihost_stats_update(&esp_xtensa->semihost, a2, &dur);
 
 	return ERROR_OK;
 }
@@ -702,6 +805,36 @@ COMMAND_HANDLER(esp_xtensa_cmd_semihost_basedir)
 		target_to_esp_xtensa(get_current_target(CMD_CTX)));
 }
 
+COMMAND_HELPER(esp_xtensa_cmd_semihost_stats_do, struct esp_xtensa_common *esp_xtensa)
+{
+	struct esp_xtensa_semihost_stats *stats = esp_xtensa->semihost.stats;
+
+	if (CMD_ARGC > 0) {
+		if (strcmp(CMD_ARGV[0], "reset") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		memset(stats, 0, sizeof(esp_xtensa->semihost.stats));
+		return ERROR_OK;
+	}
+
+	for (unsigned int i = 0; i < ESP_XTENSA_SEMIHOST_SYSCALLS_NUM; i++) {
+		if (stats[i].count == 0)
+			continue;
+		command_print(CMD, "%-8s %u calls, avg %u us, max %u us",
+			esp_xtensa_semihost_syscall_name(i),
+			stats[i].count,
+			(uint32_t)(stats[i].total_us / stats[i].count),
+			stats[i].max_us);
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(esp_xtensa_cmd_semihost_stats)
+{
+	return CALL_COMMAND_HANDLER(esp_xtensa_cmd_semihost_stats_do,
+		target_to_esp_xtensa(get_current_target(CMD_CTX)));
+}
+
 const struct command_registration esp_command_handlers[] = {
 	{
 		.name = "semihost_basedir",
@@ -710,5 +843,12 @@ const struct command_registration esp_command_handlers[] = {
 		.help = "Set the base directory for semohosting I/O.",
 		.usage = "dir",
 	},
+	{
+		.name = "semihost_stats",
+		.handler = esp_xtensa_cmd_semihost_stats,
+		.mode = COMMAND_EXEC,
+		.help = "Show or reset per syscall semihosting latency counters.",
+		.usage = "['reset']",
+	},
 	COMMAND_REGISTRATION_DONE
 };
@@ -104,8 +104,18 @@ struct esp_xtensa_special_breakpoint_ops {
 		struct esp_xtensa_special_breakpoint *spec_bp);
 };
 
+#define ESP_XTENSA_SEMIHOST_SYSCALLS_NUM    16
+
+struct esp_xtensa_semihost_stats {
+	uint32_t count;
+	uint64_t total_us;
+	uint32_t max_us;
+};
+
 struct esp_xtensa_semihost_data {
 	char *basedir;
+	/* latency counters indexed by syscall number, unknown ones are counted at index 0 */
+	struct esp_xtensa_semihost_stats stats[ESP_XTENSA_SEMIHOST_SYSCALLS_NUM];
 };
 
 struct esp_xtensa_common {
@@ -143,10 +153,13 @@ bool esp_xtensa_is_special_breakpoint(struct target *target, struct breakpoint *
 int esp_xtensa_special_breakpoints_clear(struct target *target);
 void esp_xtensa_on_reset(struct target *target);
 bool esp_xtensa_on_halt(struct target *target);
+bool esp_xtensa_semihost_pending(struct target *target);
+int esp_xtensa_do_semihosting(struct target *target);
 void esp_xtensa_on_poll(struct target *target);
 
 COMMAND_HELPER(esp_xtensa_cmd_flashbootstrap_do, struct esp_xtensa_common *esp_xtensa);
 COMMAND_HELPER(esp_xtensa_cmd_semihost_basedir_do, struct esp_xtensa_common *esp_xtensa);
+COMMAND_HELPER(esp_xtensa_cmd_semihost_stats_do, struct esp_xtensa_common *esp_xtensa);
 
 extern const struct command_registration esp_command_handlers[];
 extern const struct command_registration esp_xtensa_command_handlers[];
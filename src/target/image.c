@@ -521,6 +521,140 @@ static int image_elf_read_section(struct image *image,
 	return ERROR_OK;
 }
 
+static int image_elf_read_chunk(struct image_elf *elf, uint32_t offset, uint32_t size,
+	uint8_t **data)
+{
+	size_t read_bytes;
+
+	*data = malloc(size);
+	if (*data == NULL) {
+		LOG_ERROR("insufficient memory to perform operation ");
+		return ERROR_FILEIO_OPERATION_FAILED;
+	}
+	int retval = fileio_seek(elf->fileio, offset);
+	if (retval == ERROR_OK)
+		retval = fileio_read(elf->fileio, size, *data, &read_bytes);
+	if (retval == ERROR_OK && read_bytes != size)
+		retval = ERROR_FILEIO_OPERATION_FAILED;
+	if (retval != ERROR_OK) {
+		free(*data);
+		*data = NULL;
+	}
+	return retval;
+}
+
+static int image_symbol_compare(const void *a, const void *b)
+{
+	const struct image_symbol *sa = a, *sb = b;
+
+	if (sa->address < sb->address)
+		return -1;
+	return sa->address > sb->address;
+}
+
+static int image_elf_read_symbols(struct image *image, struct image_symbol **symbols,
+	size_t *symbols_num)
+{
+	struct image_elf *elf = image->type_private;
+	Elf32_Shdr *shdrs = NULL;
+	Elf32_Sym *syms = NULL;
+	uint8_t *strtab = NULL;
+	uint32_t i, shnum = field16(elf, elf->header->e_shnum);
+	int retval;
+
+	if (shnum == 0 || field16(elf, elf->header->e_shentsize) != sizeof(Elf32_Shdr)) {
+		LOG_ERROR("invalid ELF file, no section headers");
+		return ERROR_IMAGE_FORMAT_ERROR;
+	}
+	retval = image_elf_read_chunk(elf, field32(elf, elf->header->e_shoff),
+			shnum * sizeof(Elf32_Shdr), (uint8_t **)&shdrs);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("cannot read ELF section headers");
+		return retval;
+	}
+	for (i = 0; i < shnum; i++)
+		if (field32(elf, shdrs[i].sh_type) == SHT_SYMTAB)
+			break;
+	if (i == shnum || field32(elf, shdrs[i].sh_link) >= shnum) {
+		LOG_ERROR("no symbol table in ELF file");
+		retval = ERROR_IMAGE_FORMAT_ERROR;
+		goto done;
+	}
+	Elf32_Shdr *symtab_hdr = &shdrs[i];
+	Elf32_Shdr *strtab_hdr = &shdrs[field32(elf, symtab_hdr->sh_link)];
+	uint32_t syms_num = field32(elf, symtab_hdr->sh_size) / sizeof(Elf32_Sym);
+	uint32_t strtab_size = field32(elf, strtab_hdr->sh_size);
+	if (syms_num == 0 || strtab_size == 0) {
+		LOG_ERROR("empty symbol table in ELF file");
+		retval = ERROR_IMAGE_FORMAT_ERROR;
+		goto done;
+	}
+	retval = image_elf_read_chunk(elf, field32(elf, symtab_hdr->sh_offset),
+			syms_num * sizeof(Elf32_Sym), (uint8_t **)&syms);
+	if (retval == ERROR_OK)
+		retval = image_elf_read_chunk(elf, field32(elf, strtab_hdr->sh_offset),
+				strtab_size, &strtab);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("cannot read ELF symbol table");
+		goto done;
+	}
+	strtab[strtab_size - 1] = 0;
+
+	*symbols = calloc(syms_num, sizeof(struct image_symbol));
+	if (*symbols == NULL) {
+		LOG_ERROR("insufficient memory to perform operation ");
+		retval = ERROR_FILEIO_OPERATION_FAILED;
+		goto done;
+	}
+	*symbols_num = 0;
+	for (i = 0; i < syms_num; i++) {
+		uint32_t name = field32(elf, syms[i].st_name);
+		if (ELF32_ST_TYPE(syms[i].st_info) != STT_FUNC ||
+			field16(elf, syms[i].st_shndx) == SHN_UNDEF ||
+			name >= strtab_size)
+			continue;
+		struct image_symbol *sym = &(*symbols)[(*symbols_num)++];
+		sym->address = field32(elf, syms[i].st_value);
+		sym->size = field32(elf, syms[i].st_size);
+		sym->name = strdup((char *)strtab + name);
+		if (sym->name == NULL) {
+			LOG_ERROR("insufficient memory to perform operation ");
+			image_free_symbols(*symbols, *symbols_num);
+			*symbols = NULL;
+			*symbols_num = 0;
+			retval = ERROR_FILEIO_OPERATION_FAILED;
+			goto done;
+		}
+	}
+	qsort(*symbols, *symbols_num, sizeof(struct image_symbol), image_symbol_compare);
+
+done:
+	free(strtab);
+	free(syms);
+	free(shdrs);
+	return retval;
+}
+
+/**
+ * Reads function symbols of ELF image sorted by address.
+ * The returned array should be released with image_free_symbols().
+ */
+int image_read_symbols(struct image *image, struct image_symbol **symbols, size_t *symbols_num)
+{
+	if (image->type != IMAGE_ELF) {
+		LOG_ERROR("symbols can be read from ELF images only");
+		return ERROR_IMAGE_TYPE_UNKNOWN;
+	}
+	return image_elf_read_symbols(image, symbols, symbols_num);
+}
+
+void image_free_symbols(struct image_symbol *symbols, size_t symbols_num)
+{
+	for (size_t i = 0; i < symbols_num; i++)
+		free(symbols[i].name);
+	free(symbols);
+}
+
 static int image_mot_buffer_complete_inner(struct image *image,
 	char *lpszLine,
 	struct imagesection *section)
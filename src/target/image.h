@@ -88,6 +88,12 @@ struct image_elf {
 	uint8_t endianness;
 };
 
+struct image_symbol {
+	uint32_t address;
+	uint32_t size;
+	char *name;
+};
+
 struct image_mot {
 	struct fileio *fileio;
 	uint8_t *buffer;
@@ -104,6 +110,10 @@ int image_add_section(struct image *image, uint32_t base, uint32_t size,
 int image_calculate_checksum(uint8_t *buffer, uint32_t nbytes,
 		uint32_t *checksum);
 
+int image_read_symbols(struct image *image, struct image_symbol **symbols,
+		size_t *symbols_num);
+void image_free_symbols(struct image_symbol *symbols, size_t symbols_num);
+
 #define ERROR_IMAGE_FORMAT_ERROR	(-1400)
 #define ERROR_IMAGE_TYPE_UNKNOWN	(-1401)
 #define ERROR_IMAGE_TEMPORARILY_UNAVAILABLE		(-1402)
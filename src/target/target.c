@@ -59,6 +59,10 @@
 /* default halt wait timeout (ms) */
 #define DEFAULT_HALT_TIMEOUT 5000
 
+/* memory read cache page size and number of pages per target */
+#define TARGET_MEM_CACHE_PAGE_SIZE	1024
+#define TARGET_MEM_CACHE_PAGES		64
+
 static int target_read_buffer_default(struct target *target, target_addr_t address,
 		uint32_t count, uint8_t *buffer);
 static int target_write_buffer_default(struct target *target, target_addr_t address,
@@ -77,6 +81,10 @@ static int target_profiling_default(struct target *target, uint32_t *samples,
 
 static size_t target_get_active_core_default(struct target *target);
 static void target_set_active_core_default(struct target *target, size_t core);
+static void target_mem_cache_invalidate(void);
+static bool target_mem_cache_read(struct target *target, target_addr_t address,
+		uint32_t size, uint8_t *buffer);
+static void target_mem_cache_free(struct target *target);
 
 
 /* targets */
@@ -161,7 +169,15 @@ static struct target_type *target_types[] = {
 
 struct target *all_targets;
 static struct target_event_callback *target_event_callbacks;
-static struct target_timer_callback *target_timer_callbacks;
+/* Timer callbacks are kept in a binary min-heap ordered by the due time */
+static struct target_timer_callback **target_timer_callbacks;
+static unsigned int target_timer_callbacks_num;
+static unsigned int target_timer_callbacks_size;
+static uint64_t target_timer_callbacks_seq;
+/* callbacks taken out of the heap while being called, the buffer is reused between calls */
+static struct target_timer_callback **target_timer_callbacks_due;
+static unsigned int target_timer_callbacks_due_num;
+static unsigned int target_timer_callbacks_due_size;
 LIST_HEAD(target_reset_callback_list);
 LIST_HEAD(target_trace_callback_list);
 static const int polling_interval = 100;
@@ -580,6 +596,123 @@ int target_poll(struct target *target)
 	return ERROR_OK;
 }
 
+/*
+ * Host side memory read cache.
+ *
+ * While target is halted GDB and RTOS support read the same memory (stacks, TCBs,
+ * variables) over and over. Reads from the regions configured via "memcache add" are
+ * served from page sized copies kept on the host. Cached pages are valid for one epoch
+ * only, the epoch ends on any target event (halt, resume, reset etc.), resume, step,
+ * algorithm run, breakpoint change and memory write to any target, so targets sharing
+ * memory never see stale data.
+ */
+struct target_mem_cache_region {
+	target_addr_t address;
+	uint32_t size;
+	struct target_mem_cache_region *next;
+};
+
+struct target_mem_cache_page {
+	uint32_t epoch;		/* 0 - page is not valid */
+	target_addr_t address;
+	uint8_t data[TARGET_MEM_CACHE_PAGE_SIZE];
+};
+
+struct target_mem_cache {
+	struct target_mem_cache_region *regions;
+	struct target_mem_cache_page pages[TARGET_MEM_CACHE_PAGES];
+	uint32_t hits;
+	uint32_t misses;
+	bool filling;		/* page read is in progress, it may come back via target_read_memory() */
+};
+
+static uint32_t target_mem_cache_epoch = 1;
+
+static void target_mem_cache_invalidate(void)
+{
+	if (++target_mem_cache_epoch == 0)
+		target_mem_cache_epoch = 1;
+}
+
+uint32_t target_memory_epoch(void)
+{
+	return target_mem_cache_epoch;
+}
+
+static bool target_mem_cache_page_cacheable(struct target_mem_cache *cache, target_addr_t address)
+{
+	for (struct target_mem_cache_region *region = cache->regions; region; region = region->next) {
+		if (address >= region->address &&
+				address + TARGET_MEM_CACHE_PAGE_SIZE - 1 <= region->address + region->size - 1)
+			return true;
+	}
+	return false;
+}
+
+/* Returns true if the whole range has been read via cache */
+static bool target_mem_cache_read(struct target *target, target_addr_t address,
+		uint32_t size, uint8_t *buffer)
+{
+	struct target_mem_cache *cache = target->mem_cache;
+
+	if (!cache || !cache->regions || cache->filling || size == 0 ||
+			target->state != TARGET_HALTED)
+		return false;
+	if (address + size - 1 < address)
+		return false;
+
+	target_addr_t first = address & ~(target_addr_t)(TARGET_MEM_CACHE_PAGE_SIZE - 1);
+	target_addr_t last = (address + size - 1) & ~(target_addr_t)(TARGET_MEM_CACHE_PAGE_SIZE - 1);
+	for (target_addr_t page_addr = first; ; page_addr += TARGET_MEM_CACHE_PAGE_SIZE) {
+		if (!target_mem_cache_page_cacheable(cache, page_addr))
+			return false;
+		if (page_addr == last)
+			break;
+	}
+
+	for (target_addr_t page_addr = first; ; page_addr += TARGET_MEM_CACHE_PAGE_SIZE) {
+		struct target_mem_cache_page *page =
+			&cache->pages[(page_addr / TARGET_MEM_CACHE_PAGE_SIZE) % TARGET_MEM_CACHE_PAGES];
+		if (page->epoch != target_mem_cache_epoch || page->address != page_addr) {
+			cache->filling = true;
+			int retval = target->type->read_buffer(target, page_addr,
+					TARGET_MEM_CACHE_PAGE_SIZE, page->data);
+			cache->filling = false;
+			if (retval != ERROR_OK) {
+				/* let the caller report the error for the original range */
+				page->epoch = 0;
+				return false;
+			}
+			page->address = page_addr;
+			page->epoch = target_mem_cache_epoch;
+			cache->misses++;
+		} else {
+			cache->hits++;
+		}
+		target_addr_t start = MAX(address, page_addr);
+		target_addr_t end = MIN(address + size - 1, page_addr + TARGET_MEM_CACHE_PAGE_SIZE - 1);
+		memcpy(buffer + (start - address), page->data + (start - page_addr), end - start + 1);
+		if (page_addr == last)
+			break;
+	}
+	return true;
+}
+
+static void target_mem_cache_free(struct target *target)
+{
+	struct target_mem_cache *cache = target->mem_cache;
+
+	if (!cache)
+		return;
+	while (cache->regions) {
+		struct target_mem_cache_region *next = cache->regions->next;
+		free(cache->regions);
+		cache->regions = next;
+	}
+	free(cache);
+	target->mem_cache = NULL;
+}
+
 int target_halt(struct target *target)
 {
 	int retval;
@@ -640,6 +773,7 @@ int target_resume(struct target *target, int current, target_addr_t address,
 		return ERROR_FAIL;
 	}
 
+	target_mem_cache_invalidate();
 	target_call_event_callbacks(target, TARGET_EVENT_RESUME_START);
 
 	/* note that resume *must* be asynchronous. The CPU can halt before
@@ -852,6 +986,7 @@ int target_run_algorithm(struct target *target,
 		goto done;
 	}
 
+	target_mem_cache_invalidate();
 	target->running_alg = true;
 	retval = target->type->run_algorithm(target,
 			num_mem_params, mem_params,
@@ -891,6 +1026,7 @@ int target_start_algorithm(struct target *target,
 		goto done;
 	}
 
+	target_mem_cache_invalidate();
 	target->running_alg = true;
 	retval = target->type->start_algorithm(target,
 			num_mem_params, mem_params,
@@ -1138,6 +1274,8 @@ int target_read_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support read_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	if (target_mem_cache_read(target, address, size * count, buffer))
+		return ERROR_OK;
 	return target->type->read_memory(target, address, size, count, buffer);
 }
 
@@ -1166,6 +1304,7 @@ int target_write_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	target_mem_cache_invalidate();
 	return target->type->write_memory(target, address, size, count, buffer);
 }
 
@@ -1180,6 +1319,7 @@ int target_write_phys_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_phys_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	target_mem_cache_invalidate();
 	return target->type->write_phys_memory(target, address, size, count, buffer);
 }
 
@@ -1190,6 +1330,7 @@ int target_add_breakpoint(struct target *target,
 		LOG_WARNING("target %s is not halted (add breakpoint)", target_name(target));
 		return ERROR_TARGET_NOT_HALTED;
 	}
+	target_mem_cache_invalidate();
 	return target->type->add_breakpoint(target, breakpoint);
 }
 
@@ -1200,6 +1341,7 @@ int target_add_context_breakpoint(struct target *target,
 		LOG_WARNING("target %s is not halted (add context breakpoint)", target_name(target));
 		return ERROR_TARGET_NOT_HALTED;
 	}
+	target_mem_cache_invalidate();
 	return target->type->add_context_breakpoint(target, breakpoint);
 }
 
@@ -1210,12 +1352,14 @@ int target_add_hybrid_breakpoint(struct target *target,
 		LOG_WARNING("target %s is not halted (add hybrid breakpoint)", target_name(target));
 		return ERROR_TARGET_NOT_HALTED;
 	}
+	target_mem_cache_invalidate();
 	return target->type->add_hybrid_breakpoint(target, breakpoint);
 }
 
 int target_remove_breakpoint(struct target *target,
 		struct breakpoint *breakpoint)
 {
+	target_mem_cache_invalidate();
 	return target->type->remove_breakpoint(target, breakpoint);
 }
 
@@ -1294,6 +1438,7 @@ bool target_supports_gdb_connection(struct target *target)
 int target_step(struct target *target,
 		int current, target_addr_t address, int handle_breakpoints)
 {
+	target_mem_cache_invalidate();
 	return target->type->step(target, current, address, handle_breakpoints);
 }
 
@@ -1541,31 +1686,105 @@ int target_register_trace_callback(int (*callback)(struct target *target,
 	return ERROR_OK;
 }
 
+static bool target_timer_callback_before(struct target_timer_callback *a,
+		struct target_timer_callback *b)
+{
+	int cmp = timeval_compare(&a->when, &b->when);
+	return cmp < 0 || (cmp == 0 && a->seq < b->seq);
+}
+
+static void target_timer_heap_sift_up(unsigned int i)
+{
+	struct target_timer_callback **heap = target_timer_callbacks;
+
+	while (i > 0) {
+		unsigned int parent = (i - 1) / 2;
+		if (!target_timer_callback_before(heap[i], heap[parent]))
+			break;
+		struct target_timer_callback *tmp = heap[i];
+		heap[i] = heap[parent];
+		heap[parent] = tmp;
+		i = parent;
+	}
+}
+
+static void target_timer_heap_sift_down(unsigned int i)
+{
+	struct target_timer_callback **heap = target_timer_callbacks;
+
+	for (;;) {
+		unsigned int min = i;
+		unsigned int l = 2 * i + 1, r = 2 * i + 2;
+		if (l < target_timer_callbacks_num && target_timer_callback_before(heap[l], heap[min]))
+			min = l;
+		if (r < target_timer_callbacks_num && target_timer_callback_before(heap[r], heap[min]))
+			min = r;
+		if (min == i)
+			break;
+		struct target_timer_callback *tmp = heap[i];
+		heap[i] = heap[min];
+		heap[min] = tmp;
+		i = min;
+	}
+}
+
+static int target_timer_heap_push(struct target_timer_callback *cb)
+{
+	if (target_timer_callbacks_num == target_timer_callbacks_size) {
+		unsigned int size = target_timer_callbacks_size ? 2 * target_timer_callbacks_size : 16;
+		struct target_timer_callback **heap = realloc(target_timer_callbacks, size * sizeof(*heap));
+		if (heap == NULL) {
+			LOG_ERROR("Failed to alloc memory for timer callback!");
+			return ERROR_FAIL;
+		}
+		target_timer_callbacks = heap;
+		target_timer_callbacks_size = size;
+	}
+	target_timer_callbacks[target_timer_callbacks_num++] = cb;
+	target_timer_heap_sift_up(target_timer_callbacks_num - 1);
+	return ERROR_OK;
+}
+
+static struct target_timer_callback *target_timer_heap_remove(unsigned int i)
+{
+	struct target_timer_callback *cb = target_timer_callbacks[i];
+
+	target_timer_callbacks[i] = target_timer_callbacks[--target_timer_callbacks_num];
+	if (i < target_timer_callbacks_num) {
+		target_timer_heap_sift_down(i);
+		target_timer_heap_sift_up(i);
+	}
+	return cb;
+}
+
 int target_register_timer_callback(int (*callback)(void *priv),
 		unsigned int time_ms, enum target_timer_type type, void *priv)
 {
-	struct target_timer_callback **callbacks_p = &target_timer_callbacks;
+	struct target_timer_callback *cb;
 
 	if (callback == NULL)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
-	if (*callbacks_p) {
-		while ((*callbacks_p)->next)
-			callbacks_p = &((*callbacks_p)->next);
-		callbacks_p = &((*callbacks_p)->next);
+	cb = malloc(sizeof(struct target_timer_callback));
+	if (cb == NULL) {
+		LOG_ERROR("Failed to alloc memory for timer callback!");
+		return ERROR_FAIL;
 	}
+	cb->callback = callback;
+	cb->type = type;
+	cb->time_ms = time_ms;
+	cb->removed = false;
+	cb->seq = target_timer_callbacks_seq++;
 
-	(*callbacks_p) = malloc(sizeof(struct target_timer_callback));
-	(*callbacks_p)->callback = callback;
-	(*callbacks_p)->type = type;
-	(*callbacks_p)->time_ms = time_ms;
-	(*callbacks_p)->removed = false;
+	gettimeofday(&cb->when, NULL);
+	timeval_add_time(&cb->when, 0, time_ms * 1000);
 
-	gettimeofday(&(*callbacks_p)->when, NULL);
-	timeval_add_time(&(*callbacks_p)->when, 0, time_ms * 1000);
+	cb->priv = priv;
 
-	(*callbacks_p)->priv = priv;
-	(*callbacks_p)->next = NULL;
+	if (target_timer_heap_push(cb) != ERROR_OK) {
+		free(cb);
+		return ERROR_FAIL;
+	}
 
 	return ERROR_OK;
 }
@@ -1636,9 +1855,17 @@ int target_unregister_timer_callback(int (*callback)(void *priv), void *priv)
 	if (callback == NULL)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
-	for (struct target_timer_callback *c = target_timer_callbacks;
-	     c; c = c->next) {
+	for (unsigned int i = 0; i < target_timer_callbacks_num; i++) {
+		struct target_timer_callback *c = target_timer_callbacks[i];
 		if ((c->callback == callback) && (c->priv == priv)) {
+			free(target_timer_heap_remove(i));
+			return ERROR_OK;
+		}
+	}
+	/* callbacks being called are freed once the round is over */
+	for (unsigned int i = 0; i < target_timer_callbacks_due_num; i++) {
+		struct target_timer_callback *c = target_timer_callbacks_due[i];
+		if ((c->callback == callback) && (c->priv == priv) && !c->removed) {
 			c->removed = true;
 			return ERROR_OK;
 		}
@@ -1652,6 +1879,9 @@ int target_call_event_callbacks(struct target *target, enum target_event event)
 	struct target_event_callback *callback = target_event_callbacks;
 	struct target_event_callback *next_callback;
 
+	/* any state change (halt, resume, reset etc.) starts new cache epoch */
+	target_mem_cache_invalidate();
+
 	if (event == TARGET_EVENT_HALTED) {
 		/* execute early halted first */
 		target_call_event_callbacks(target, TARGET_EVENT_GDB_HALT);
@@ -1695,25 +1925,6 @@ int target_call_trace_callbacks(struct target *target, size_t len, uint8_t *data
 	return ERROR_OK;
 }
 
-static int target_timer_callback_periodic_restart(
-		struct target_timer_callback *cb, struct timeval *now)
-{
-	cb->when = *now;
-	timeval_add_time(&cb->when, 0, cb->time_ms * 1000L);
-	return ERROR_OK;
-}
-
-static int target_call_timer_callback(struct target_timer_callback *cb,
-		struct timeval *now)
-{
-	cb->callback(cb->priv);
-
-	if (cb->type == TARGET_TIMER_TYPE_PERIODIC)
-		return target_timer_callback_periodic_restart(cb, now);
-
-	return target_unregister_timer_callback(cb->callback, cb->priv);
-}
-
 static int target_call_timer_callbacks_check_time(int checktime)
 {
 	static bool callback_processing;
@@ -1729,26 +1940,59 @@ static int target_call_timer_callbacks_check_time(int checktime)
 	struct timeval now;
 	gettimeofday(&now, NULL);
 
-	/* Store an address of the place containing a pointer to the
-	 * next item; initially, that's a standalone "root of the
-	 * list" variable. */
-	struct target_timer_callback **callback = &target_timer_callbacks;
-	while (*callback) {
-		if ((*callback)->removed) {
-			struct target_timer_callback *p = *callback;
-			*callback = (*callback)->next;
-			free(p);
-			continue;
+	/* Take the callbacks to be called out of the heap first, so the ones
+	 * (re)registered by the callbacks are not called in this round */
+	if (target_timer_callbacks_due_size < target_timer_callbacks_num) {
+		struct target_timer_callback **due = realloc(target_timer_callbacks_due,
+				target_timer_callbacks_size * sizeof(*due));
+		if (due == NULL) {
+			LOG_ERROR("Failed to alloc memory for timer callbacks!");
+			callback_processing = false;
+			return ERROR_FAIL;
 		}
+		target_timer_callbacks_due = due;
+		target_timer_callbacks_due_size = target_timer_callbacks_size;
+	}
+	struct target_timer_callback **due = target_timer_callbacks_due;
+	unsigned int due_num = 0;
+	if (checktime) {
+		while (target_timer_callbacks_num > 0 &&
+				timeval_compare(&now, &target_timer_callbacks[0]->when) >= 0)
+			due[due_num++] = target_timer_heap_remove(0);
+	} else {
+		/* periodic callbacks are invoked immediately */
+		unsigned int keep = 0;
+		for (unsigned int i = 0; i < target_timer_callbacks_num; i++) {
+			struct target_timer_callback *cb = target_timer_callbacks[i];
+			if (cb->type == TARGET_TIMER_TYPE_PERIODIC ||
+					timeval_compare(&now, &cb->when) >= 0)
+				due[due_num++] = cb;
+			else
+				target_timer_callbacks[keep++] = cb;
+		}
+		target_timer_callbacks_num = keep;
+		for (unsigned int i = keep / 2; i-- > 0; )
+			target_timer_heap_sift_down(i);
+	}
+	target_timer_callbacks_due_num = due_num;
 
-		bool call_it = (*callback)->callback &&
-			((!checktime && (*callback)->type == TARGET_TIMER_TYPE_PERIODIC) ||
-			 timeval_compare(&now, &(*callback)->when) >= 0);
-
-		if (call_it)
-			target_call_timer_callback(*callback, &now);
+	for (unsigned int i = 0; i < due_num; i++) {
+		struct target_timer_callback *cb = due[i];
+		if (!cb->removed && cb->callback)
+			cb->callback(cb->priv);
+	}
 
-		callback = &(*callback)->next;
+	target_timer_callbacks_due_num = 0;
+	for (unsigned int i = 0; i < due_num; i++) {
+		struct target_timer_callback *cb = due[i];
+		if (cb->removed || cb->type != TARGET_TIMER_TYPE_PERIODIC) {
+			free(cb);
+			continue;
+		}
+		cb->when = now;
+		timeval_add_time(&cb->when, 0, cb->time_ms * 1000L);
+		if (target_timer_heap_push(cb) != ERROR_OK)
+			free(cb);
 	}
 
 	callback_processing = false;
@@ -1766,6 +2010,20 @@ int target_call_timer_callbacks_now(void)
 	return target_call_timer_callbacks_check_time(0);
 }
 
+int64_t target_timer_next_callback_delay(void)
+{
+	if (target_timer_callbacks_num == 0)
+		return -1;
+
+	struct timeval now, delay;
+	gettimeofday(&now, NULL);
+	if (timeval_compare(&now, &target_timer_callbacks[0]->when) >= 0)
+		return 0;
+	timeval_subtract(&delay, &target_timer_callbacks[0]->when, &now);
+	/* round up, so the callback is due when we wake up */
+	return (int64_t)delay.tv_sec * 1000 + (delay.tv_usec + 999) / 1000;
+}
+
 /* Prints the working area layout for debug purposes */
 static void print_wa_layout(struct working_area_config *wa_cfg)
 {
@@ -2123,6 +2381,7 @@ static void target_destroy(struct target *target)
 	}
 
 	target_free_all_working_areas(target);
+	target_mem_cache_free(target);
 
 	/* release the targets SMP list */
 	if (target->smp) {
@@ -2154,13 +2413,15 @@ void target_quit(void)
 	}
 	target_event_callbacks = NULL;
 
-	struct target_timer_callback *pt = target_timer_callbacks;
-	while (pt) {
-		struct target_timer_callback *t = pt->next;
-		free(pt);
-		pt = t;
-	}
+	for (unsigned int i = 0; i < target_timer_callbacks_num; i++)
+		free(target_timer_callbacks[i]);
+	free(target_timer_callbacks);
 	target_timer_callbacks = NULL;
+	target_timer_callbacks_num = 0;
+	target_timer_callbacks_size = 0;
+	free(target_timer_callbacks_due);
+	target_timer_callbacks_due = NULL;
+	target_timer_callbacks_due_size = 0;
 
 	for (struct target *target = all_targets; target;) {
 		struct target *tmp;
@@ -2289,6 +2550,7 @@ int target_write_buffer(struct target *target, target_addr_t address, uint32_t s
 		return ERROR_FAIL;
 	}
 
+	target_mem_cache_invalidate();
 	return target->type->write_buffer(target, address, size, buffer);
 }
 
@@ -2351,6 +2613,8 @@ int target_read_buffer(struct target *target, target_addr_t address, uint32_t si
 		return ERROR_FAIL;
 	}
 
+	if (target_mem_cache_read(target, address, size, buffer))
+		return ERROR_OK;
 	return target->type->read_buffer(target, address, size, buffer);
 }
 
@@ -5360,6 +5624,64 @@ COMMAND_HANDLER(handle_target_event_list)
 	command_print(CMD, "***END***");
 	return ERROR_OK;
 }
+COMMAND_HANDLER(handle_target_mem_cache_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC == 0) {
+		struct target_mem_cache *cache = target->mem_cache;
+		if (!cache || !cache->regions) {
+			command_print(CMD, "memory cache is disabled");
+			return ERROR_OK;
+		}
+		for (struct target_mem_cache_region *region = cache->regions; region;
+				region = region->next)
+			command_print(CMD, "cacheable region " TARGET_ADDR_FMT " size 0x%" PRIx32,
+					region->address, region->size);
+		command_print(CMD, "hits %" PRIu32 " pages, misses %" PRIu32 " pages",
+				cache->hits, cache->misses);
+		return ERROR_OK;
+	}
+
+	if (strcmp(CMD_ARGV[0], "add") == 0) {
+		if (CMD_ARGC != 3)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		target_addr_t address;
+		uint32_t size;
+		COMMAND_PARSE_ADDRESS(CMD_ARGV[1], address);
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], size);
+		if (size == 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		if (!target->mem_cache) {
+			target->mem_cache = calloc(1, sizeof(struct target_mem_cache));
+			if (!target->mem_cache) {
+				LOG_ERROR("Failed to alloc memory cache!");
+				return ERROR_FAIL;
+			}
+		}
+		struct target_mem_cache_region *region = malloc(sizeof(*region));
+		if (!region) {
+			LOG_ERROR("Failed to alloc memory cache region!");
+			return ERROR_FAIL;
+		}
+		region->address = address;
+		region->size = size;
+		region->next = target->mem_cache->regions;
+		target->mem_cache->regions = region;
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (strcmp(CMD_ARGV[0], "clear") == 0)
+		target_mem_cache_free(target);
+	else if (strcmp(CMD_ARGV[0], "flush") == 0)
+		target_mem_cache_invalidate();
+	else
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	return ERROR_OK;
+}
+
 static int jim_target_current_state(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 {
 	if (argc != 1) {
@@ -5477,6 +5799,14 @@ static const struct command_registration target_instance_command_handlers[] = {
 			"from target memory",
 		.usage = "arrayname bitwidth address count",
 	},
+	{
+		.name = "memcache",
+		.handler = handle_target_mem_cache_command,
+		.mode = COMMAND_EXEC,
+		.help = "configure host side cache for target memory reads "
+			"done while target is halted",
+		.usage = "[add address size | clear | flush]",
+	},
 	{
 		.name = "eventlist",
 		.handler = handle_target_event_list,
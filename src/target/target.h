@@ -217,6 +217,9 @@ struct target {
 
 	/* The semihosting information, extracted from the target. */
 	struct semihosting *semihosting;
+
+	/* host side cache for memory reads while halted, NULL when disabled */
+	struct target_mem_cache *mem_cache;
 };
 
 struct target_list {
@@ -331,8 +334,9 @@ struct target_timer_callback {
 	enum target_timer_type type;
 	bool removed;
 	struct timeval when;
+	/* registration order, breaks ties between callbacks due at the same time */
+	uint64_t seq;
 	void *priv;
-	struct target_timer_callback *next;
 };
 
 struct target_exit_callback {
@@ -410,6 +414,11 @@ int target_call_timer_callbacks(void);
  * a synchronous command completes.
  */
 int target_call_timer_callbacks_now(void);
+/**
+ * Returns the number of milliseconds until the earliest timer callback is due,
+ * 0 if some callback is already overdue or -1 if there are no timer callbacks.
+ */
+int64_t target_timer_next_callback_delay(void);
 
 struct target *get_target_by_num(int num);
 struct target *get_current_target(struct command_context *cmd_ctx);
@@ -641,6 +650,13 @@ int target_write_phys_memory(struct target *target,
  */
 int target_write_buffer(struct target *target,
 		target_addr_t address, uint32_t size, const uint8_t *buffer);
+/**
+ * Returns the counter which is changed every time the target memory contents
+ * could have been changed: on resume, step, memory write, target event etc.
+ * Host side copies of target memory are valid while the counter is unchanged.
+ */
+uint32_t target_memory_epoch(void);
+
 int target_read_buffer(struct target *target,
 		target_addr_t address, uint32_t size, uint8_t *buffer);
 int target_checksum_memory(struct target *target,
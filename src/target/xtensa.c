@@ -24,6 +24,7 @@
 
 #include "xtensa.h"
 #include "xtensa_algorithm.h"
+#include "xtensa_trax.h"
 #include "register.h"
 #include "time_support.h"
 
@@ -266,14 +267,18 @@ static inline bool xtensa_is_dcacheable(struct xtensa *xtensa, target_addr_t add
 		address);
 }
 
+static int xtensa_fetch_regs(struct target *target, bool only_invalid);
+
 static int xtensa_get_core_reg(struct reg *reg)
 {
-	/*We don't need this because we read all registers on halt anyway. */
+	/*Registers are read on halt, in lazy mode only the core ones, see xtensa_fetch_halt_regs(). */
 	struct xtensa *xtensa = (struct xtensa *)reg->arch_info;
 	struct target *target = xtensa->target;
 
 	if (target->state != TARGET_HALTED)
 		return ERROR_TARGET_NOT_HALTED;
+	if (!reg->valid && !xtensa->regs_fetched)
+		return xtensa_fetch_regs(target, true);
 	return ERROR_OK;
 }
 
@@ -564,7 +569,7 @@ int xtensa_examine(struct target *target)
 	return ERROR_OK;
 }
 
-int xtensa_wakeup(struct target *target)
+void xtensa_queue_wakeup(struct target *target)
 {
 	struct xtensa *xtensa = target_to_xtensa(target);
 	int cmd = PWRCTL_DEBUGWAKEUP|PWRCTL_MEMWAKEUP|PWRCTL_COREWAKEUP;
@@ -574,6 +579,13 @@ int xtensa_wakeup(struct target *target)
 	xtensa_queue_pwr_reg_write(xtensa, DMREG_PWRCTL, cmd);
 	/* TODO: can we join this with the write above? */
 	xtensa_queue_pwr_reg_write(xtensa, DMREG_PWRCTL, cmd | PWRCTL_JTAGDEBUGUSE);
+}
+
+int xtensa_wakeup(struct target *target)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+
+	xtensa_queue_wakeup(target);
 	xtensa_dm_queue_tdi_idle(&xtensa->dbg_mod);
 	return jtag_execute_queue();
 }
@@ -651,6 +663,11 @@ xtensa_reg_val_t xtensa_reg_get(struct target *target, enum xtensa_reg_id reg_id
 {
 	struct xtensa *xtensa = target_to_xtensa(target);
 	struct reg *reg = &xtensa->core_cache->reg_list[reg_id];
+	if (!reg->valid && !xtensa->regs_fetched && target->state == TARGET_HALTED) {
+		int res = xtensa_fetch_regs(target, true);
+		if (res != ERROR_OK)
+			LOG_ERROR("%s: Failed to fetch registers (%d)!", target_name(target), res);
+	}
 	return xtensa_reg_get_value(reg);
 }
 
@@ -658,7 +675,8 @@ void xtensa_reg_set(struct target *target, enum xtensa_reg_id reg_id, xtensa_reg
 {
 	struct xtensa *xtensa = target_to_xtensa(target);
 	struct reg *reg = &xtensa->core_cache->reg_list[reg_id];
-	if (xtensa_reg_get_value(reg) == value)
+	/* cached value can be compared only if it is valid */
+	if (reg->valid && xtensa_reg_get_value(reg) == value)
 		return;
 	xtensa_reg_set_value(reg, value);
 }
@@ -673,6 +691,8 @@ int xtensa_assert_reset(struct target *target)
 		target_name(target),
 		target->coreid,
 		target->target_number);
+	/* release while target is halted to restore working areas backup */
+	xtensa_algo_resident_release(target);
 	target->state = TARGET_RESET;
 	xtensa_queue_pwr_reg_write(xtensa,
 		DMREG_PWRCTL,
@@ -708,7 +728,107 @@ int xtensa_deassert_reset(struct target *target)
 	return res;
 }
 
+/* Registers read on halt in lazy mode */
+static const enum xtensa_reg_id xtensa_core_sregs[] = {
+	XT_REG_IDX_PC,
+	XT_REG_IDX_PS,
+	XT_REG_IDX_DEBUGCAUSE,
+	XT_REG_IDX_EXCCAUSE,
+	XT_REG_IDX_WINDOWBASE,
+};
+
+/* Reads A0-A15 and the special registers needed to handle the halt.
+ * Other registers are read on the first access. */
+int xtensa_fetch_core_regs(struct target *target)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+	struct reg *reg_list = xtensa->core_cache->reg_list;
+	uint8_t aregs[16][sizeof(xtensa_reg_val_t)];
+	uint8_t sregs[ARRAY_SIZE(xtensa_core_sregs)][sizeof(xtensa_reg_val_t)];
+	int res;
+
+	LOG_DEBUG("%s: start", target_name(target));
+
+	for (int i = 0; i < 16; i++) {
+		xtensa_queue_exec_ins(xtensa,
+			XT_INS_WSR(XT_SR_DDR, xtensa_regs[XT_REG_IDX_AR0 + i].reg_num));
+		xtensa_queue_dbg_reg_read(xtensa, NARADR_DDR, aregs[i]);
+	}
+	/*A0-A15 are saved now, so use A3 as a scratch register. */
+	for (size_t i = 0; i < ARRAY_SIZE(xtensa_core_sregs); i++) {
+		enum xtensa_reg_id reg_id = xtensa_core_sregs[i];
+		if (!reg_list[reg_id].exist)
+			continue;
+		int reg_num = xtensa_regs[reg_id].reg_num;
+		if (reg_num == XT_PC_REG_NUM_BASE) {
+			/* reg number of PC for debug interrupt depends on NDEBUGLEVEL */
+			reg_num += xtensa->core_config->debug.irq_level;
+		}
+		xtensa_queue_exec_ins(xtensa, XT_INS_RSR(reg_num, XT_REG_A3));
+		xtensa_queue_exec_ins(xtensa, XT_INS_WSR(XT_SR_DDR, XT_REG_A3));
+		xtensa_queue_dbg_reg_read(xtensa, NARADR_DDR, sregs[i]);
+	}
+	res = jtag_execute_queue();
+	if (res != ERROR_OK) {
+		LOG_ERROR("Failed to read core regs!");
+		return res;
+	}
+	res = xtensa_core_status_check(target);
+	if (res != ERROR_OK) {
+		LOG_ERROR("Exception reading core regs!");
+		return res;
+	}
+
+	for (unsigned int i = 0; i < XT_NUM_REGS; i++)
+		reg_list[i].valid = 0;
+	for (int i = 0; i < 16; i++) {
+		xtensa_reg_set(target, XT_REG_IDX_A0 + i, buf_get_u32(aregs[i], 0, 32));
+		reg_list[XT_REG_IDX_A0 + i].valid = 1;
+		reg_list[XT_REG_IDX_A0 + i].dirty = 0;
+	}
+	for (size_t i = 0; i < ARRAY_SIZE(xtensa_core_sregs); i++) {
+		enum xtensa_reg_id reg_id = xtensa_core_sregs[i];
+		if (!reg_list[reg_id].exist)
+			continue;
+		xtensa_reg_set(target, reg_id, buf_get_u32(sregs[i], 0, 32));
+		reg_list[reg_id].valid = 1;
+		reg_list[reg_id].dirty = 0;
+	}
+	xtensa->regs_fetched = false;
+	/*We have used A3 as a scratch register and we will need to write that back. */
+	xtensa_mark_register_dirty(xtensa, XT_REG_IDX_A3);
+
+	return ERROR_OK;
+}
+
+/* Reads registers after the target has halted, all of them or only the core ones in lazy mode */
+int xtensa_fetch_halt_regs(struct target *target)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+
+	if (xtensa->lazy_regs)
+		return xtensa_fetch_core_regs(target);
+	return xtensa_fetch_all_regs(target);
+}
+
+/* Completes xtensa_fetch_halt_regs() after xtensa_fetch_core_regs() has been called on halt */
+int xtensa_fetch_rest_regs(struct target *target)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+
+	if (xtensa->lazy_regs)
+		return ERROR_OK;
+	return xtensa_fetch_regs(target, true);
+}
+
 int xtensa_fetch_all_regs(struct target *target)
+{
+	return xtensa_fetch_regs(target, false);
+}
+
+/* When 'only_invalid' is set, registers which are already valid (read by xtensa_fetch_core_regs()
+ * or set by the user) are kept intact. */
+static int xtensa_fetch_regs(struct target *target, bool only_invalid)
 {
 	struct xtensa *xtensa = target_to_xtensa(target);
 	struct reg *reg_list = xtensa->core_cache->reg_list;
@@ -767,6 +887,7 @@ int xtensa_fetch_all_regs(struct target *target)
 	 *Grab the SFRs and user registers first. We use A3 as a scratch register. */
 	for (i = 0; i < XT_NUM_REGS; i++) {
 		if (xtensa_reg_is_readable(xtensa_regs[i].flags, cpenable) && reg_list[i].exist &&
+			!(only_invalid && reg_list[i].valid) &&
 			(xtensa_regs[i].type == XT_REG_SPECIAL ||
 				xtensa_regs[i].type == XT_REG_USER || xtensa_regs[i].type ==
 				XT_REG_FR)) {
@@ -801,6 +922,7 @@ int xtensa_fetch_all_regs(struct target *target)
 	/*DSR checking: follows order in which registers are requested. */
 	for (i = 0; i < XT_NUM_REGS; i++) {
 		if (xtensa_reg_is_readable(xtensa_regs[i].flags, cpenable) && reg_list[i].exist &&
+			!(only_invalid && reg_list[i].valid) &&
 			(xtensa_regs[i].type == XT_REG_SPECIAL ||
 				xtensa_regs[i].type == XT_REG_USER || xtensa_regs[i].type ==
 				XT_REG_FR)) {
@@ -813,9 +935,14 @@ int xtensa_fetch_all_regs(struct target *target)
 
 	if (xtensa->core_config->windowed) {
 		/*We need the windowbase to decode the general addresses. */
-		windowbase = buf_get_u32(regvals[XT_REG_IDX_WINDOWBASE], 0, 32);
+		if (only_invalid && reg_list[XT_REG_IDX_WINDOWBASE].valid)
+			windowbase = xtensa_reg_get_value(&reg_list[XT_REG_IDX_WINDOWBASE]);
+		else
+			windowbase = buf_get_u32(regvals[XT_REG_IDX_WINDOWBASE], 0, 32);
 		/*Decode the result and update the cache. */
 		for (i = 0; i < XT_NUM_REGS; i++) {
+			if (only_invalid && reg_list[i].valid)
+				continue;
 			if (xtensa_reg_is_readable(xtensa_regs[i].flags,
 					cpenable) && reg_list[i].exist) {
 				if (xtensa_regs[i].type == XT_REG_GENERAL) {
@@ -849,7 +976,21 @@ int xtensa_fetch_all_regs(struct target *target)
 				 * 0); */
 			}
 		}
+		if (only_invalid) {
+			/*Scratch registers have been modified since A0-A15 were read, so physical
+			 * registers they are mapped to get the cached values. */
+			for (i = 0; i < 16; i++) {
+				j = xtensa_windowbase_offset_to_canonical(XT_REG_IDX_AR0 + i, windowbase);
+				if (j - XT_REG_IDX_AR0 < (int)xtensa->core_config->aregs_num &&
+					reg_list[XT_REG_IDX_A0 + i].valid) {
+					memcpy(reg_list[j].value, reg_list[XT_REG_IDX_A0 + i].value,
+						sizeof(xtensa_reg_val_t));
+					reg_list[j].valid = 1;
+				}
+			}
+		}
 	}
+	xtensa->regs_fetched = true;
 	/*We have used A3 as a scratch register and we will need to write that back. */
 	xtensa_mark_register_dirty(xtensa, XT_REG_IDX_A3);
 
@@ -948,6 +1089,10 @@ int xtensa_prepare_resume(struct target *target,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
+	/* user code can use memory occupied by resident stub */
+	if (!debug_execution)
+		xtensa_algo_resident_release(target);
+
 	if (address && !current)
 		xtensa_reg_set(target, XT_REG_IDX_PC, address);
 	else {
@@ -1338,11 +1483,17 @@ int xtensa_read_memory(struct target *target,
 	/*Write start address to A3 */
 	xtensa_queue_dbg_reg_write(xtensa, NARADR_DDR, addrstart_al);
 	xtensa_queue_exec_ins(xtensa, XT_INS_RSR(XT_SR_DDR, XT_REG_A3));
-	/*Now we can safely read data from addrstart_al up to addrend_al into albuff */
-	while (adr != addrend_al) {
+	/*Now we can safely read data from addrstart_al up to addrend_al into albuff.
+	 *Load the first word, this also leaves LDDR32P in DIR0. Every DDREXEC read returns DDR and
+	 *re-executes DIR0, which fetches the next word, so only one NAR access per word is needed.
+	 *The last word is read via DDR to avoid reading past the end of the range. */
+	if (adr != addrend_al)
 		xtensa_queue_exec_ins(xtensa, XT_INS_LDDR32P(XT_REG_A3));
-		xtensa_queue_dbg_reg_read(xtensa, NARADR_DDR, &albuff[i]);
+	while (adr != addrend_al) {
 		adr += sizeof(uint32_t);
+		xtensa_queue_dbg_reg_read(xtensa,
+			adr != addrend_al ? NARADR_DDREXEC : NARADR_DDR,
+			&albuff[i]);
 		i += sizeof(uint32_t);
 	}
 	res = jtag_execute_queue();
@@ -1447,10 +1598,11 @@ int xtensa_write_memory(struct target *target,
 	/*Write start address to A3 */
 	xtensa_queue_dbg_reg_write(xtensa, NARADR_DDR, addrstart_al);
 	xtensa_queue_exec_ins(xtensa, XT_INS_RSR(XT_SR_DDR, XT_REG_A3));
-	/*Write the aligned buffer */
+	/*Write the aligned buffer. Put SDDR32P to DIR0 without executing it, then every DDREXEC
+	 *write sets DDR and executes DIR0, storing one word per NAR access. */
+	xtensa_queue_dbg_reg_write(xtensa, NARADR_DIR0, XT_INS_SDDR32P(XT_REG_A3));
 	while (adr != addrend_al) {
-		xtensa_queue_dbg_reg_write(xtensa, NARADR_DDR, buf_get_u32(&albuff[i], 0, 32));
-		xtensa_queue_exec_ins(xtensa, XT_INS_SDDR32P(XT_REG_A3));
+		xtensa_queue_dbg_reg_write(xtensa, NARADR_DDREXEC, buf_get_u32(&albuff[i], 0, 32));
 		adr += 4;
 		i += 4;
 	}
@@ -1484,13 +1636,233 @@ int xtensa_write_buffer(struct target *target,
 	return xtensa_write_memory(target, address, 1, count, buffer);
 }
 
+static void xtensa_crc32_table_init(uint32_t *table)
+{
+	/* as per gdb, the same as in image_calculate_checksum() */
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t c = i << 24;
+		for (int j = 0; j < 8; j++)
+			c = c & 0x80000000 ? (c << 1) ^ 0x04c11db7 : (c << 1);
+		table[i] = c;
+	}
+}
+
+static uint32_t xtensa_crc32_update(const uint32_t *table, uint32_t crc, const uint8_t *buf,
+	uint32_t len)
+{
+	while (len--)
+		crc = (crc << 8) ^ table[((crc >> 24) ^ *buf++) & 255];
+	return crc;
+}
+
+/* Target reads memory by words only, so unaligned head and tail bytes are processed on host */
 int xtensa_checksum_memory(struct target *target,
 	target_addr_t address,
 	uint32_t count,
 	uint32_t *checksum)
 {
-	LOG_WARNING("not implemented yet");
-	return ERROR_FAIL;
+	struct working_area *crc_algorithm, *crc_table;
+	struct xtensa_algorithm algorithm_info;
+	struct reg_param reg_params[5];
+	uint32_t table[256];
+	uint8_t table_buf[sizeof(table)];
+	uint8_t edge_buf[4];
+	int retval;
+
+	static const uint8_t xtensa_crc_code[] = {
+#include "../../contrib/loaders/checksum/xtensa_crc.inc"
+	};
+
+	target_addr_t start = (address + 3) & ~3ULL;
+	target_addr_t end = (address + count) & ~3ULL;
+	if (start >= end)
+		return ERROR_FAIL;	/* too small, let target_checksum_memory() do it on host */
+
+	retval = target_alloc_working_area(target, sizeof(xtensa_crc_code), &crc_algorithm);
+	if (retval != ERROR_OK) {
+		/* memory can be occupied by resident stub */
+		xtensa_algo_resident_release(target);
+		retval = target_alloc_working_area(target, sizeof(xtensa_crc_code), &crc_algorithm);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	retval = target_alloc_alt_working_area(target, sizeof(table_buf), &crc_table);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, crc_algorithm);
+		return retval;
+	}
+
+	retval = target_write_buffer(target, crc_algorithm->address,
+		sizeof(xtensa_crc_code), xtensa_crc_code);
+	if (retval != ERROR_OK)
+		goto _cleanup;
+	xtensa_crc32_table_init(table);
+	for (int i = 0; i < 256; i++)
+		target_buffer_set_u32(target, &table_buf[i * sizeof(uint32_t)], table[i]);
+	retval = target_write_buffer(target, crc_table->address, sizeof(table_buf), table_buf);
+	if (retval != ERROR_OK)
+		goto _cleanup;
+
+	uint32_t crc = 0xffffffff;
+	if (start != address) {
+		retval = target_read_buffer(target, address, start - address, edge_buf);
+		if (retval != ERROR_OK)
+			goto _cleanup;
+		crc = xtensa_crc32_update(table, crc, edge_buf, start - address);
+	}
+
+	init_reg_param(&reg_params[0], "a2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "a3", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "a4", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "a5", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[4], "ps", 32, PARAM_OUT);
+	buf_set_u32(reg_params[0].value, 0, 32, start);
+	buf_set_u32(reg_params[1].value, 0, 32, end);
+	buf_set_u32(reg_params[2].value, 0, 32, crc_table->address);
+	buf_set_u32(reg_params[3].value, 0, 32, crc);
+	/* mask interrupts, the code is not windowed, so leave WOE off */
+	buf_set_u32(reg_params[4].value, 0, 32, XT_PS_UM | XT_PS_INTLEVEL(5));
+	algorithm_info.core_mode = XT_MODE_ANY;
+
+	int timeout = 20000 * (1 + (count / (1024 * 1024)));
+	retval = target_run_algorithm(target, 0, NULL, 5, reg_params, crc_algorithm->address,
+		crc_algorithm->address + (sizeof(xtensa_crc_code) - 3),
+		timeout, &algorithm_info);
+	if (retval == ERROR_OK)
+		crc = buf_get_u32(reg_params[3].value, 0, 32);
+	else
+		LOG_ERROR("error executing xtensa crc algorithm");
+
+	for (int i = 0; i < 5; i++)
+		destroy_reg_param(&reg_params[i]);
+
+	if (retval == ERROR_OK && end != address + count) {
+		retval = target_read_buffer(target, end, address + count - end, edge_buf);
+		if (retval == ERROR_OK)
+			crc = xtensa_crc32_update(table, crc, edge_buf, address + count - end);
+	}
+	if (retval == ERROR_OK)
+		*checksum = crc;
+
+_cleanup:
+	target_free_alt_working_area(target, crc_table);
+	target_free_working_area(target, crc_algorithm);
+	return retval;
+}
+
+/* Continuous trace capture state of one core */
+struct xtensa_trace_capture {
+	FILE *file;
+	char *file_name;
+	/* max size of the trace file, when it is exceeded the file is rotated to '<file>.1' */
+	uint64_t max_size;
+	uint64_t file_size;
+	uint64_t total_size;
+	uint32_t windows_num;
+	uint32_t rotations_num;
+	struct xtensa_trace_start_config cfg;
+};
+
+static void xtensa_trace_capture_free(struct xtensa_trace_capture *capture)
+{
+	if (capture->file)
+		fclose(capture->file);
+	free(capture->file_name);
+	free(capture);
+}
+
+void xtensa_trace_capture_stop(struct xtensa *xtensa)
+{
+	if (!xtensa->trace_capture)
+		return;
+	xtensa_trace_capture_free(xtensa->trace_capture);
+	xtensa->trace_capture = NULL;
+}
+
+/* Returns number of valid words in trace memory */
+static uint32_t xtensa_trace_words_num(const struct xtensa_trace_config *config)
+{
+	uint32_t memsz = config->memaddr_end - config->memaddr_start + 1;
+
+	if ((config->addr & ((TRAXADDR_TWRAP_MASK << TRAXADDR_TWRAP_SHIFT) | TRAXADDR_TWSAT)) == 0) {
+		/* memory hasn't overwritten itself yet */
+		uint32_t wmem = config->addr & TRAXADDR_TADDR_MASK;
+		if (wmem < memsz)
+			memsz = wmem;
+	}
+	return memsz;
+}
+
+static int xtensa_trace_capture_rotate(struct xtensa_trace_capture *capture)
+{
+	char *old_name = alloc_printf("%s.1", capture->file_name);
+
+	if (!old_name) {
+		LOG_ERROR("Failed to alloc memory for trace file name!");
+		return ERROR_FAIL;
+	}
+	fclose(capture->file);
+	capture->file = NULL;
+	int res = rename(capture->file_name, old_name);
+	free(old_name);
+	if (res != 0) {
+		LOG_ERROR("Failed to rotate trace file '%s' (%d)!", capture->file_name, errno);
+		return ERROR_FAIL;
+	}
+	capture->file = fopen(capture->file_name, "wb");
+	if (!capture->file) {
+		LOG_ERROR("Failed to open '%s' (%d)!", capture->file_name, errno);
+		return ERROR_FAIL;
+	}
+	capture->file_size = 0;
+	capture->rotations_num++;
+	return ERROR_OK;
+}
+
+/* Drains stopped trace memory to the capture file and re-arms TRAX with the same config */
+static int xtensa_trace_capture_window(struct xtensa *xtensa)
+{
+	struct xtensa_trace_capture *capture = xtensa->trace_capture;
+	struct xtensa_trace_config trace_config;
+
+	int res = xtensa_dm_trace_config_read(&xtensa->dbg_mod, &trace_config);
+	if (res != ERROR_OK)
+		return res;
+
+	uint32_t words = xtensa_trace_words_num(&trace_config);
+	if (words > 0) {
+		uint8_t *tracemem = malloc(words * 4);
+		if (!tracemem) {
+			LOG_ERROR("Failed to alloc memory for trace data!");
+			return ERROR_FAIL;
+		}
+		res = xtensa_dm_trace_data_read(&xtensa->dbg_mod, tracemem, words);
+		if (res != ERROR_OK) {
+			free(tracemem);
+			return res;
+		}
+		if (capture->file_size > 0 && capture->file_size + words * 4 > capture->max_size) {
+			res = xtensa_trace_capture_rotate(capture);
+			if (res != ERROR_OK) {
+				free(tracemem);
+				return res;
+			}
+		}
+		size_t wr_sz = fwrite(tracemem, 1, words * 4, capture->file);
+		free(tracemem);
+		if (wr_sz != words * 4) {
+			LOG_ERROR("Failed to write to '%s'!", capture->file_name);
+			return ERROR_FAIL;
+		}
+		fflush(capture->file);
+		capture->file_size += wr_sz;
+		capture->total_size += wr_sz;
+	}
+	capture->windows_num++;
+	LOG_DEBUG("%s: captured trace window %u, %u words",
+		target_name(xtensa->target), capture->windows_num, words);
+
+	return xtensa_dm_trace_start(&xtensa->dbg_mod, &capture->cfg);
 }
 
 /* do some general work upon poll */
@@ -1505,23 +1877,122 @@ void xtensa_on_poll(struct target *target)
 		res = xtensa_dm_trace_status_read(&xtensa->dbg_mod, &trace_status);
 		if (res == ERROR_OK) {
 			if (!(trace_status.stat & TRAXSTAT_TRACT)) {
-				LOG_INFO("Detected end of trace.");
-				if (trace_status.stat & TRAXSTAT_PCMTG)
-					LOG_INFO("%s: Trace stop triggered by PC match",
-						target_name(target));
-				if (trace_status.stat &TRAXSTAT_PTITG)
-					LOG_INFO(
-						"%s: Trace stop triggered by Processor Trigger Input",
-						target_name(target));
-				if (trace_status.stat & TRAXSTAT_CTITG)
-					LOG_INFO("%s: Trace stop triggered by Cross-trigger Input",
-						target_name(target));
+				if (xtensa->trace_capture) {
+					/* every captured window ends here, do not flood the log */
+					LOG_DEBUG("%s: Detected end of trace window, status 0x%x",
+						target_name(target), trace_status.stat);
+				} else {
+					LOG_INFO("Detected end of trace.");
+					if (trace_status.stat & TRAXSTAT_PCMTG)
+						LOG_INFO("%s: Trace stop triggered by PC match",
+							target_name(target));
+					if (trace_status.stat &TRAXSTAT_PTITG)
+						LOG_INFO(
+							"%s: Trace stop triggered by Processor Trigger Input",
+							target_name(target));
+					if (trace_status.stat & TRAXSTAT_CTITG)
+						LOG_INFO("%s: Trace stop triggered by Cross-trigger Input",
+							target_name(target));
+				}
 				xtensa->trace_active = false;
+				if (xtensa->trace_capture) {
+					res = xtensa_trace_capture_window(xtensa);
+					if (res == ERROR_OK) {
+						xtensa->trace_active = true;
+					} else {
+						LOG_ERROR("%s: Trace capture failed, stopped.",
+							target_name(target));
+						xtensa_trace_capture_stop(xtensa);
+					}
+				}
 			}
 		}
 	}
 }
 
+/* Number of PC reads per core queued for one JTAG queue execution when profiling */
+#define XTENSA_PROFILING_BATCH_SZ   64
+
+/* Samples PC of the running cores via DEBUGPC register without halting them.
+ * 'cores' is an array of 'cores_num' targets, samples of all cores go to the same buffer. */
+int xtensa_profiling_sample_pc(struct target *cores, size_t cores_num, uint32_t *samples,
+	uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+{
+	struct xtensa *xtensa0 = target_to_xtensa(&cores[0]);
+	struct timeval timeout, now;
+	uint32_t sample_count = 0;
+	int retval = ERROR_OK;
+
+	uint8_t (*pc_bufs)[4] = malloc(XTENSA_PROFILING_BATCH_SZ * cores_num * sizeof(*pc_bufs));
+	if (!pc_bufs) {
+		LOG_ERROR("Failed to alloc memory for PC samples!");
+		return ERROR_FAIL;
+	}
+
+	gettimeofday(&timeout, NULL);
+	timeval_add_time(&timeout, seconds, 0);
+	for (;;) {
+		uint32_t reads_num = MIN(XTENSA_PROFILING_BATCH_SZ * cores_num,
+			max_num_samples - sample_count);
+		for (uint32_t i = 0; i < reads_num; i++) {
+			struct xtensa *xtensa = target_to_xtensa(&cores[i % cores_num]);
+			xtensa_dm_queue_debug_pc_read(&xtensa->dbg_mod, pc_bufs[i]);
+		}
+		/* check that cores are still running, DEBUGPC of the halted core is meaningless */
+		for (size_t i = 0; i < cores_num; i++)
+			xtensa_dm_queue_core_status_read(&target_to_xtensa(&cores[i])->dbg_mod);
+		xtensa_dm_queue_tdi_idle(&xtensa0->dbg_mod);
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error while reading DEBUGPC");
+			break;
+		}
+		keep_alive();
+		bool halted = false;
+		for (size_t i = 0; i < cores_num; i++) {
+			struct xtensa *xtensa = target_to_xtensa(&cores[i]);
+			xtensa_dm_core_status_update(&xtensa->dbg_mod);
+			if (xtensa_dm_core_status_get(&xtensa->dbg_mod) & OCDDSR_STOPPED)
+				halted = true;
+		}
+		if (halted) {
+			LOG_WARNING("Core halted, profiling stopped. %" PRIu32 " samples.", sample_count);
+			break;
+		}
+		for (uint32_t i = 0; i < reads_num; i++)
+			samples[sample_count++] = buf_get_u32(pc_bufs[i], 0, 32);
+
+		gettimeofday(&now, NULL);
+		if (sample_count >= max_num_samples || timeval_compare(&now, &timeout) > 0) {
+			LOG_INFO("Profiling completed. %" PRIu32 " samples.", sample_count);
+			break;
+		}
+	}
+	free(pc_bufs);
+
+	*num_samples = sample_count;
+	return retval;
+}
+
+int xtensa_profiling(struct target *target, uint32_t *samples,
+	uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+{
+	int retval = ERROR_OK;
+
+	LOG_INFO("Starting Xtensa profiling. Sampling DEBUGPC as fast as we can...");
+	/* Make sure the target is running */
+	target_poll(target);
+	if (target->state == TARGET_HALTED)
+		retval = target_resume(target, 1, 0, 0, 0);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error while resuming target");
+		return retval;
+	}
+
+	return xtensa_profiling_sample_pc(target, 1, samples, max_num_samples, num_samples,
+		seconds);
+}
+
 int xtensa_poll(struct target *target)
 {
 	struct xtensa *xtensa = target_to_xtensa(target);
@@ -1556,9 +2027,30 @@ int xtensa_poll(struct target *target)
 		if (target->state != TARGET_HALTED) {
 			enum target_state oldstate = target->state;
 			target->state = TARGET_HALTED;
+			gettimeofday(&xtensa->halt_time, NULL);
+			xtensa->fast_halt_done = false;
 			/*Examine why the target has been halted */
 			target->debug_reason = DBG_REASON_DBGRQ;
-			xtensa_fetch_all_regs(target);
+			if (oldstate != TARGET_DEBUG_RUNNING && xtensa->chip_ops != NULL &&
+				xtensa->chip_ops->on_fast_halt != NULL) {
+				/* let the chip serve the requests from the target software (e.g.
+				 * semihosting) before reading the rest of registers */
+				res = xtensa_fetch_core_regs(target);
+				if (res == ERROR_OK && xtensa->chip_ops->on_fast_halt(target)) {
+					xtensa_dm_core_status_clear(&xtensa->dbg_mod,
+						OCDDSR_DEBUGPENDBREAK|OCDDSR_DEBUGINTBREAK|
+						OCDDSR_DEBUGPENDHOST|OCDDSR_DEBUGINTHOST);
+					target->debug_reason = DBG_REASON_BREAKPOINT;
+					need_resume = true;
+					goto _poll_done;
+				}
+				if (res == ERROR_OK) {
+					xtensa->fast_halt_done = true;
+					xtensa_fetch_rest_regs(target);
+				} else
+					xtensa_fetch_halt_regs(target);
+			} else
+				xtensa_fetch_halt_regs(target);
 			/* When setting debug reason DEBUGCAUSE events have the followuing
 			 * priorites: watchpoint == breakpoint > single step > debug interrupt. */
 			/* Watchpoint and breakpoint events at the same time results in special
@@ -1610,6 +2102,7 @@ int xtensa_poll(struct target *target)
 			target->debug_reason = DBG_REASON_NOTHALTED;
 		}
 	}
+_poll_done:
 	if (xtensa->chip_ops != NULL && xtensa->chip_ops->on_poll != NULL)
 		xtensa->chip_ops->on_poll(target);
 
@@ -2141,6 +2634,9 @@ void xtensa_deinit(struct target *target)
 	struct xtensa *xtensa = target_to_xtensa(target);
 
 	LOG_DEBUG("start");
+	xtensa_perfmon_sampling_stop(xtensa);
+	xtensa_trace_capture_stop(xtensa);
+	xtensa_algo_resident_release(target);
 	int ret = xtensa_queue_dbg_reg_write(xtensa, NARADR_DCRCLR, OCDDCR_ENABLEOCD);
 	if (ret != ERROR_OK) {
 		LOG_ERROR("Failed to queue OCDDCR_ENABLEOCD clear operation!");
@@ -2171,6 +2667,27 @@ COMMAND_HANDLER(xtensa_cmd_permissive_mode)
 		target_to_xtensa(get_current_target(CMD_CTX)));
 }
 
+COMMAND_HELPER(xtensa_cmd_lazy_regs_do, struct xtensa *xtensa)
+{
+	if (CMD_ARGC == 0) {
+		command_print(CMD, "%d", xtensa->lazy_regs);
+		return ERROR_OK;
+	}
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	bool is_one = strcmp(CMD_ARGV[0], "1") == 0;
+	if (!is_one && strcmp(CMD_ARGV[0], "0") != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;	/* 0 or 1 only */
+	xtensa->lazy_regs = is_one;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(xtensa_cmd_lazy_regs)
+{
+	return CALL_COMMAND_HANDLER(xtensa_cmd_lazy_regs_do,
+		target_to_xtensa(get_current_target(CMD_CTX)));
+}
+
 /* perfmon_enable <counter_id> <select> [mask] [kernelcnt] [tracelevel] */
 COMMAND_HELPER(xtensa_cmd_perfmon_enable_do, struct xtensa *xtensa)
 {
@@ -2239,7 +2756,7 @@ COMMAND_HELPER(xtensa_cmd_perfmon_dump_do, struct xtensa *xtensa)
 	int counter_id = -1;
 	if (CMD_ARGC == 1) {
 		counter_id = strtol(CMD_ARGV[0], NULL, 0);
-		if (counter_id > XTENSA_MAX_PERF_COUNTERS) {
+		if (counter_id >= XTENSA_MAX_PERF_COUNTERS) {
 			LOG_ERROR("counter_id should be < %d", XTENSA_MAX_PERF_COUNTERS);
 			return ERROR_COMMAND_SYNTAX_ERROR;
 		}
@@ -2271,6 +2788,192 @@ COMMAND_HANDLER(xtensa_cmd_perfmon_dump)
 		target_to_xtensa(get_current_target(CMD_CTX)));
 }
 
+/* Background perfmon sampling state of one core */
+struct xtensa_perfmon_core_sample {
+	struct xtensa *xtensa;
+	struct xtensa_perfmon_counters_buf buf;
+	struct xtensa_perfmon_result results[XTENSA_MAX_PERF_COUNTERS];
+	/* last raw values, used to extend counters which are not chained to 64 bits */
+	uint32_t last[XTENSA_MAX_PERF_COUNTERS];
+	uint64_t value[XTENSA_MAX_PERF_COUNTERS];
+};
+
+struct xtensa_perfmon_sampler {
+	FILE *file;
+	char *file_name;
+	unsigned int period_ms;
+	int64_t start_ms;
+	uint64_t samples_num;
+	size_t cores_num;
+	struct xtensa_perfmon_core_sample *cores;
+};
+
+static void xtensa_perfmon_sampler_free(struct xtensa_perfmon_sampler *sampler)
+{
+	if (sampler->file)
+		fclose(sampler->file);
+	free(sampler->file_name);
+	free(sampler->cores);
+	free(sampler);
+}
+
+/* Reads counters of all cores in one JTAG queue execution and writes a CSV line with
+ * the time since the sampling start and the value and overflow flag of every counter. */
+static int xtensa_perfmon_sample(void *priv)
+{
+	struct xtensa_perfmon_sampler *sampler = priv;
+	struct xtensa *xtensa0 = sampler->cores[0].xtensa;
+
+	if (!target_was_examined(xtensa0->target) || xtensa0->target->state == TARGET_RESET)
+		return ERROR_OK;
+
+	bool consistent = false;
+	for (int attempt = 0; attempt < XTENSA_PERFMON_READ_RETRIES && !consistent; attempt++) {
+		for (size_t i = 0; i < sampler->cores_num; i++)
+			xtensa_dm_queue_perfmon_counters_read(&sampler->cores[i].xtensa->dbg_mod,
+				&sampler->cores[i].buf);
+		xtensa_dm_queue_tdi_idle(&xtensa0->dbg_mod);
+		int res = jtag_execute_queue();
+		if (res != ERROR_OK) {
+			LOG_DEBUG("Failed to read perfmon counters (%d)!", res);
+			return ERROR_OK;
+		}
+		consistent = true;
+		for (size_t i = 0; i < sampler->cores_num; i++) {
+			if (!xtensa_dm_perfmon_counters_get(&sampler->cores[i].buf,
+					sampler->cores[i].results))
+				consistent = false;
+		}
+	}
+	if (!consistent) {
+		LOG_DEBUG("Chained perfmon counters changed while being read, skip sample!");
+		return ERROR_OK;
+	}
+
+	fprintf(sampler->file, "%" PRId64, timeval_ms() - sampler->start_ms);
+	for (size_t i = 0; i < sampler->cores_num; i++) {
+		struct xtensa_perfmon_core_sample *core = &sampler->cores[i];
+
+		for (int c = 0; c < XTENSA_MAX_PERF_COUNTERS; c++) {
+			if (core->results[c].chained) {
+				core->value[c] = core->results[c].value;
+			} else {
+				uint32_t raw = core->results[c].value;
+				/* 32-bit counter wraps, assume it can not wrap twice between samples */
+				if (sampler->samples_num == 0)
+					core->value[c] = raw;
+				else
+					core->value[c] += (uint32_t)(raw - core->last[c]);
+				core->last[c] = raw;
+			}
+			fprintf(sampler->file, ",%" PRIu64 ",%d", core->value[c], core->results[c].overflow);
+		}
+	}
+	fputc('\n', sampler->file);
+	sampler->samples_num++;
+
+	return ERROR_OK;
+}
+
+void xtensa_perfmon_sampling_stop(struct xtensa *xtensa)
+{
+	if (!xtensa->perfmon_sampler)
+		return;
+	target_unregister_timer_callback(xtensa_perfmon_sample, xtensa->perfmon_sampler);
+	xtensa_perfmon_sampler_free(xtensa->perfmon_sampler);
+	xtensa->perfmon_sampler = NULL;
+}
+
+/* perfmon_sample [<file> [period_ms] | stop] */
+COMMAND_HELPER(xtensa_cmd_perfmon_sample_do, struct xtensa *cores[], size_t cores_num)
+{
+	struct xtensa *xtensa0 = cores[0];
+	struct xtensa_perfmon_sampler *sampler = xtensa0->perfmon_sampler;
+	unsigned int period_ms = 100;
+
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (CMD_ARGC == 0) {
+		if (!sampler)
+			command_print(CMD, "Perfmon sampling is not running");
+		else
+			command_print(CMD, "Perfmon sampling to '%s' every %u ms, %" PRIu64 " samples",
+				sampler->file_name, sampler->period_ms, sampler->samples_num);
+		return ERROR_OK;
+	}
+	if (strcmp(CMD_ARGV[0], "stop") == 0) {
+		if (!sampler) {
+			command_print(CMD, "Perfmon sampling is not running");
+			return ERROR_OK;
+		}
+		command_print(CMD, "Written %" PRIu64 " samples to '%s'",
+			sampler->samples_num, sampler->file_name);
+		xtensa_perfmon_sampling_stop(xtensa0);
+		return ERROR_OK;
+	}
+	if (sampler) {
+		command_print(CMD, "Perfmon sampling is already running!");
+		return ERROR_FAIL;
+	}
+	if (CMD_ARGC > 1)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], period_ms);
+	if (period_ms == 0) {
+		command_print(CMD, "period_ms should be > 0");
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	sampler = calloc(1, sizeof(*sampler));
+	if (!sampler) {
+		LOG_ERROR("Failed to alloc memory for perfmon sampler!");
+		return ERROR_FAIL;
+	}
+	sampler->cores = calloc(cores_num, sizeof(*sampler->cores));
+	sampler->file_name = strdup(CMD_ARGV[0]);
+	if (!sampler->cores || !sampler->file_name) {
+		LOG_ERROR("Failed to alloc memory for perfmon sampler!");
+		xtensa_perfmon_sampler_free(sampler);
+		return ERROR_FAIL;
+	}
+	sampler->file = fopen(sampler->file_name, "w");
+	if (!sampler->file) {
+		command_print(CMD, "Failed to open '%s' (%d)!", sampler->file_name, errno);
+		xtensa_perfmon_sampler_free(sampler);
+		return ERROR_FAIL;
+	}
+	sampler->period_ms = period_ms;
+	sampler->cores_num = cores_num;
+	fprintf(sampler->file, "time_ms");
+	for (size_t i = 0; i < cores_num; i++) {
+		sampler->cores[i].xtensa = cores[i];
+		for (int c = 0; c < XTENSA_MAX_PERF_COUNTERS; c++)
+			fprintf(sampler->file, ",cpu%u_pm%d,cpu%u_pm%d_ovf",
+				(unsigned int)i, c, (unsigned int)i, c);
+	}
+	fputc('\n', sampler->file);
+
+	sampler->start_ms = timeval_ms();
+	/* the first sample is taken right away, it is the base for the counters extension */
+	xtensa_perfmon_sample(sampler);
+	int res = target_register_timer_callback(xtensa_perfmon_sample,
+		period_ms,
+		TARGET_TIMER_TYPE_PERIODIC,
+		sampler);
+	if (res != ERROR_OK) {
+		xtensa_perfmon_sampler_free(sampler);
+		return res;
+	}
+	xtensa0->perfmon_sampler = sampler;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(xtensa_cmd_perfmon_sample)
+{
+	struct xtensa *xtensa = target_to_xtensa(get_current_target(CMD_CTX));
+
+	return CALL_COMMAND_HANDLER(xtensa_cmd_perfmon_sample_do, &xtensa, 1);
+}
+
 COMMAND_HELPER(xtensa_cmd_mask_interrupts_do, struct xtensa *xtensa)
 {
 	int state = -1;
@@ -2307,40 +3010,46 @@ COMMAND_HANDLER(xtensa_cmd_mask_interrupts)
 		target_to_xtensa(get_current_target(CMD_CTX)));
 }
 
-COMMAND_HELPER(xtensa_cmd_tracestart_do, struct xtensa *xtensa)
+/* Parses trace start config arguments starting from 'first_arg':
+ * [pc <pcval>/[maskbitcount]] [after <n> [ins|words]] */
+static COMMAND_HELPER(xtensa_cmd_trace_config_parse, unsigned int first_arg,
+	struct xtensa_trace_start_config *cfg)
 {
-	int res;
-	unsigned int i;
-	struct xtensa_trace_start_config cfg = {
-		.stoppc = 0,
-		.stopmask = -1,
-		.after = 0,
-		.after_is_words = false
-	};
+	cfg->stoppc = 0;
+	cfg->stopmask = -1;
+	cfg->after = 0;
+	cfg->after_is_words = false;
 
-	/*Parse arguments */
-	for (i = 0; i < CMD_ARGC; i++) {
-		if ((!strcasecmp(CMD_ARGV[i], "pc")) && CMD_ARGC > i) {
+	for (unsigned int i = first_arg; i < CMD_ARGC; i++) {
+		if ((!strcasecmp(CMD_ARGV[i], "pc")) && CMD_ARGC > i + 1) {
 			char *e;
 			i++;
-			cfg.stoppc = strtol(CMD_ARGV[i], &e, 0);
-			cfg.stopmask = 0;
+			cfg->stoppc = strtol(CMD_ARGV[i], &e, 0);
+			cfg->stopmask = 0;
 			if (*e == '/')
-				cfg.stopmask = strtol(e, NULL, 0);
-		} else if ((!strcasecmp(CMD_ARGV[i], "after")) && CMD_ARGC > i) {
+				cfg->stopmask = strtol(e + 1, NULL, 0);
+		} else if ((!strcasecmp(CMD_ARGV[i], "after")) && CMD_ARGC > i + 1) {
 			i++;
-			cfg.after = strtol(CMD_ARGV[i], NULL, 0);
+			cfg->after = strtol(CMD_ARGV[i], NULL, 0);
 		} else if (!strcasecmp(CMD_ARGV[i], "ins"))
-			cfg.after_is_words = 0;
+			cfg->after_is_words = 0;
 		else if (!strcasecmp(CMD_ARGV[i], "words"))
-			cfg.after_is_words = 1;
+			cfg->after_is_words = 1;
 		else {
 			command_print(CMD, "Did not understand %s", CMD_ARGV[i]);
 			return ERROR_FAIL;
 		}
 	}
-	/* TODO: check this, it was copied from original ESP32/ESP108 implementation */
-	cfg.stopmask = 1;
+	return ERROR_OK;
+}
+
+COMMAND_HELPER(xtensa_cmd_tracestart_do, struct xtensa *xtensa)
+{
+	struct xtensa_trace_start_config cfg;
+
+	int res = CALL_COMMAND_HANDLER(xtensa_cmd_trace_config_parse, 0, &cfg);
+	if (res != ERROR_OK)
+		return res;
 
 	res = xtensa_dm_trace_stop(&xtensa->dbg_mod);
 	if (res != ERROR_OK)
@@ -2439,9 +3148,11 @@ COMMAND_HELPER(xtensa_cmd_tracedump_do, struct xtensa *xtensa, const char *fname
 		command_print(CMD, "Failed to alloc memory for trace data!");
 		return ERROR_FAIL;
 	}
-	res = xtensa_dm_trace_data_read(&xtensa->dbg_mod, tracemem, memsz*4);
-	if (res != ERROR_OK)
+	res = xtensa_dm_trace_data_read(&xtensa->dbg_mod, tracemem, memsz);
+	if (res != ERROR_OK) {
+		free(tracemem);
 		return res;
+	}
 
 	int f = open(fname, O_WRONLY|O_CREAT|O_TRUNC, 0666);
 	if (f <= 0) {
@@ -2466,6 +3177,7 @@ COMMAND_HELPER(xtensa_cmd_tracedump_do, struct xtensa *xtensa, const char *fname
 		command_print(
 			CMD,
 			"WARNING: File written is all zeroes. Are you sure you enabled trace memory?");
+	free(tracemem);
 
 	return ERROR_OK;
 }
@@ -2481,6 +3193,98 @@ COMMAND_HANDLER(xtensa_cmd_tracedump)
 		target_to_xtensa(get_current_target(CMD_CTX)), CMD_ARGV[0]);
 }
 
+/* tracecapture [<file> [max_size] [pc <pcval>/[maskbitcount]] [after <n> [ins|words]] | stop] */
+COMMAND_HELPER(xtensa_cmd_tracecapture_do, struct xtensa *xtensa, const char *fname)
+{
+	struct xtensa_trace_capture *capture = xtensa->trace_capture;
+	const char *name = target_name(xtensa->target);
+	uint64_t max_size = 16 * 1024 * 1024;
+
+	if (CMD_ARGC == 0) {
+		if (!capture)
+			command_print(CMD, "%s: Trace capture is not running", name);
+		else
+			command_print(CMD,
+				"%s: Trace capture to '%s': %u windows, %" PRIu64 " bytes, %u rotations",
+				name,
+				capture->file_name,
+				capture->windows_num,
+				capture->total_size,
+				capture->rotations_num);
+		return ERROR_OK;
+	}
+	if (strcmp(CMD_ARGV[0], "stop") == 0) {
+		if (!capture) {
+			command_print(CMD, "%s: Trace capture is not running", name);
+			return ERROR_OK;
+		}
+		command_print(CMD, "%s: Captured %u windows, %" PRIu64 " bytes to '%s'",
+			name, capture->windows_num, capture->total_size, capture->file_name);
+		xtensa_trace_capture_stop(xtensa);
+		int res = xtensa_dm_trace_stop(&xtensa->dbg_mod);
+		xtensa->trace_active = false;
+		return res;
+	}
+	if (capture) {
+		command_print(CMD, "%s: Trace capture is already running!", name);
+		return ERROR_FAIL;
+	}
+	unsigned int cfg_arg = 1;
+	if (CMD_ARGC > 1 && isdigit((unsigned char)CMD_ARGV[1][0])) {
+		COMMAND_PARSE_NUMBER(u64, CMD_ARGV[1], max_size);
+		cfg_arg++;
+	}
+	if (max_size == 0) {
+		command_print(CMD, "max_size should be > 0");
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	capture = calloc(1, sizeof(*capture));
+	if (!capture) {
+		LOG_ERROR("Failed to alloc memory for trace capture!");
+		return ERROR_FAIL;
+	}
+	int res = CALL_COMMAND_HANDLER(xtensa_cmd_trace_config_parse, cfg_arg, &capture->cfg);
+	if (res != ERROR_OK) {
+		xtensa_trace_capture_free(capture);
+		return res;
+	}
+	capture->max_size = max_size;
+	capture->file_name = strdup(fname);
+	if (!capture->file_name) {
+		LOG_ERROR("Failed to alloc memory for trace capture!");
+		xtensa_trace_capture_free(capture);
+		return ERROR_FAIL;
+	}
+	capture->file = fopen(capture->file_name, "wb");
+	if (!capture->file) {
+		command_print(CMD, "Failed to open '%s' (%d)!", capture->file_name, errno);
+		xtensa_trace_capture_free(capture);
+		return ERROR_FAIL;
+	}
+
+	res = xtensa_dm_trace_stop(&xtensa->dbg_mod);
+	if (res == ERROR_OK)
+		res = xtensa_dm_trace_start(&xtensa->dbg_mod, &capture->cfg);
+	if (res != ERROR_OK) {
+		xtensa_trace_capture_free(capture);
+		return res;
+	}
+	xtensa->trace_capture = capture;
+	xtensa->trace_active = true;
+	command_print(CMD, "%s: Trace capture started.", name);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(xtensa_cmd_tracecapture)
+{
+	if (CMD_ARGC > 0 && strcmp(CMD_ARGV[0], "stop") != 0)
+		return CALL_COMMAND_HANDLER(xtensa_cmd_tracecapture_do,
+			target_to_xtensa(get_current_target(CMD_CTX)), CMD_ARGV[0]);
+	return CALL_COMMAND_HANDLER(xtensa_cmd_tracecapture_do,
+		target_to_xtensa(get_current_target(CMD_CTX)), NULL);
+}
+
 const struct command_registration xtensa_command_handlers[] = {
 	{
 		.name = "set_permissive",
@@ -2489,6 +3293,14 @@ const struct command_registration xtensa_command_handlers[] = {
 		.help = "When set to 1, enable ESP108 permissive mode (less client-side checks)",
 		.usage = "[0|1]",
 	},
+	{
+		.name = "lazy_regs",
+		.handler = xtensa_cmd_lazy_regs,
+		.mode = COMMAND_ANY,
+		.help = "When set to 1, read only PC, PS, DEBUGCAUSE, EXCCAUSE, WINDOWBASE and A0-A15 "
+			"on halt, other registers are read on the first access",
+		.usage = "[0|1]",
+	},
 	{
 		.name = "maskisr",
 		.handler = xtensa_cmd_mask_interrupts,
@@ -2511,6 +3323,14 @@ const struct command_registration xtensa_command_handlers[] = {
 			"Dump performance counter value. If no argument specified, dumps all counters.",
 		.usage = "[counter_id]",
 	},
+	{
+		.name = "perfmon_sample",
+		.handler = xtensa_cmd_perfmon_sample,
+		.mode = COMMAND_EXEC,
+		.help =
+			"Periodically read all performance counters and write timestamped values to CSV file. Without arguments shows sampling status.",
+		.usage = "[<file> [period_ms] | 'stop']",
+	},
 	{
 		.name = "tracestart",
 		.handler = xtensa_cmd_tracestart,
@@ -2533,5 +3353,19 @@ const struct command_registration xtensa_command_handlers[] = {
 		.help = "Tracing: Dump trace memory to a files. One file per core.",
 		.usage = "<outfile>",
 	},
+	{
+		.name = "tracecapture",
+		.handler = xtensa_cmd_tracecapture,
+		.mode = COMMAND_EXEC,
+		.help =
+			"Tracing: Continuously capture trace. TRAX is re-armed on every trace stop and its memory is appended to file, which is rotated to '<file>.1' when max_size (bytes, default 16MB) is reached. Without arguments shows capture status.",
+		.usage =
+			"[<file> [max_size] [pc <pcval>/[maskbitcount]] [after <n> [ins|words]] | 'stop']",
+	},
+	{
+		.mode = COMMAND_ANY,
+		.usage = "",
+		.chain = xtensa_trax_command_handlers,
+	},
 	COMMAND_REGISTRATION_DONE
 };
@@ -118,6 +118,8 @@
 #define XT_PS_RING_GET(_v_)     (((_v_) >> 6) & 0x3)
 #define XT_PS_CALLINC_MSK       (0x3 << 16)
 #define XT_PS_OWB_MSK           (0xF << 8)
+#define XT_PS_INTLEVEL(_v_)     ((uint32_t)((_v_) & 0xF))
+#define XT_PS_UM                (1 << 5)
 
 #define XT_INS_L32E(R,S,T) _XT_INS_FORMAT_RRI4(0x90000,0,R,S,T)
 #define XT_INS_S32E(R,S,T) _XT_INS_FORMAT_RRI4(0x490000,0,R,S,T)
@@ -270,11 +272,19 @@ struct xtensa_chip_ops {
 	void (*on_reset)(struct target *target);
 	void (*on_poll)(struct target *target);
 	bool (*on_halt)(struct target *target);
+	/* Called on halt with only the core registers read (see xtensa_fetch_core_regs()).
+	 * Returns true if the halt has been served and the target should be resumed without
+	 * the usual halt processing, e.g. for semihosting calls. */
+	bool (*on_fast_halt)(struct target *target);
 };
 
 /**
  * Represents a generic Xtensa core.
  */
+struct xtensa_stub_resident;
+struct xtensa_perfmon_sampler;
+struct xtensa_trace_capture;
+
 struct xtensa {
 	const struct xtensa_config *core_config;
 	struct xtensa_debug_module dbg_mod;
@@ -290,6 +300,20 @@ struct xtensa {
 	bool trace_active;
 	bool permissive_mode;
 	bool suppress_dsr_errors;
+	/* read only core registers on halt, the rest on the first access */
+	bool lazy_regs;
+	/* all registers have been read since the last halt */
+	bool regs_fetched;
+	/* chip's on_fast_halt() has been called for the current halt and did not serve it */
+	bool fast_halt_done;
+	/* time when the current halt has been detected */
+	struct timeval halt_time;
+	/* stub kept loaded on target between algorithm runs, see xtensa_algorithm.h */
+	struct xtensa_stub_resident *stub_resident;
+	/* background perfmon sampling, for multi-core chips it is kept by the first core */
+	struct xtensa_perfmon_sampler *perfmon_sampler;
+	/* continuous trace capture, TRAX is re-armed and drained to file on every trace stop */
+	struct xtensa_trace_capture *trace_capture;
 };
 
 static inline struct xtensa *target_to_xtensa(struct target *target)
@@ -395,11 +419,15 @@ static inline int xtensa_core_status_clear(struct target *target, xtensa_dsr_t b
 int xtensa_core_status_check(struct target *target);
 
 int xtensa_examine(struct target *target);
+void xtensa_queue_wakeup(struct target *target);
 int xtensa_wakeup(struct target *target);
 int xtensa_smpbreak_set(struct target *target, uint32_t set);
 xtensa_reg_val_t xtensa_reg_get(struct target *target, enum xtensa_reg_id reg_id);
 void xtensa_reg_set(struct target *target, enum xtensa_reg_id reg_id, xtensa_reg_val_t value);
 int xtensa_fetch_all_regs(struct target *target);
+int xtensa_fetch_halt_regs(struct target *target);
+int xtensa_fetch_core_regs(struct target *target);
+int xtensa_fetch_rest_regs(struct target *target);
 int xtensa_get_gdb_reg_list(struct target *target,
 	struct reg **reg_list[],
 	int *reg_list_size,
@@ -447,6 +475,10 @@ int xtensa_write_buffer(struct target *target,
 	const uint8_t *buffer);
 int xtensa_checksum_memory(struct target *target, target_addr_t address,
 	uint32_t count, uint32_t *checksum);
+int xtensa_profiling(struct target *target, uint32_t *samples,
+	uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds);
+int xtensa_profiling_sample_pc(struct target *cores, size_t cores_num, uint32_t *samples,
+	uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds);
 int xtensa_assert_reset(struct target *target);
 int xtensa_deassert_reset(struct target *target);
 int xtensa_breakpoint_add(struct target *target, struct breakpoint *breakpoint);
@@ -470,12 +502,17 @@ int xtensa_run_algorithm(struct target *target,
 	int timeout_ms, void *arch_info);
 
 COMMAND_HELPER(xtensa_cmd_permissive_mode_do, struct xtensa *xtensa);
+COMMAND_HELPER(xtensa_cmd_lazy_regs_do, struct xtensa *xtensa);
 COMMAND_HELPER(xtensa_cmd_mask_interrupts_do, struct xtensa *xtensa);
 COMMAND_HELPER(xtensa_cmd_perfmon_dump_do, struct xtensa *xtensa);
 COMMAND_HELPER(xtensa_cmd_perfmon_enable_do, struct xtensa *xtensa);
+COMMAND_HELPER(xtensa_cmd_perfmon_sample_do, struct xtensa *cores[], size_t cores_num);
+void xtensa_perfmon_sampling_stop(struct xtensa *xtensa);
 COMMAND_HELPER(xtensa_cmd_tracestart_do, struct xtensa *xtensa);
 COMMAND_HELPER(xtensa_cmd_tracestop_do, struct xtensa *xtensa);
 COMMAND_HELPER(xtensa_cmd_tracedump_do, struct xtensa *xtensa, const char *fname);
+COMMAND_HELPER(xtensa_cmd_tracecapture_do, struct xtensa *xtensa, const char *fname);
+void xtensa_trace_capture_stop(struct xtensa *xtensa);
 
 extern const struct command_registration xtensa_command_handlers[];
 
@@ -33,11 +33,27 @@
 #define XTENSA_STUB_STACK_DEBUG      0
 #endif
 
+#define XTENSA_STUB_RESIDENT_SECT_MAX    4
+
 struct xtensa_stub_tramp {
 	uint32_t size;
 	const uint8_t *code;
 };
 
+struct xtensa_stub_resident {
+	/* working areas of the loaded stub stay allocated */
+	struct xtensa_stub stub;
+	uint32_t stack_size;
+	/* image layout to check that the same stub is requested */
+	uint32_t bss_size;
+	int num_sections;
+	struct {
+		target_addr_t base_address;
+		uint32_t size;
+		uint32_t flags;
+	} sections[XTENSA_STUB_RESIDENT_SECT_MAX];
+};
+
 static void xtensa_stub_tramp_get(struct xtensa *xtensa, struct xtensa_stub_tramp *tramp)
 {
 	static const uint8_t xtensa_stub_tramp_win[] = {
@@ -84,6 +100,53 @@ static void xtensa_algo_args_init(struct xtensa_stub *stub, uint32_t stack_addr)
 								 * interrupts level (6) */
 }
 
+static void xtensa_stub_areas_free(struct target *target, struct xtensa_stub *stub)
+{
+	if (stub->tramp)
+		target_free_working_area(target, stub->tramp);
+	if (stub->stack)
+		target_free_alt_working_area(target, stub->stack);
+	if (stub->code)
+		target_free_working_area(target, stub->code);
+	if (stub->data)
+		target_free_alt_working_area(target, stub->data);
+}
+
+static int xtensa_stub_section_write(struct target *target,
+	struct xtensa_algo_image *algo_image,
+	int sect_idx)
+{
+	struct imagesection *section = &algo_image->image.sections[sect_idx];
+	uint32_t sec_wr = 0;
+	uint8_t buf[512];
+
+	while (sec_wr < section->size) {
+		uint32_t nb = section->size - sec_wr >
+			sizeof(buf) ? sizeof(buf) : section->size - sec_wr;
+		size_t size_read = 0;
+		int retval = image_read_section(&(algo_image->image),
+			sect_idx,
+			sec_wr,
+			nb,
+			buf,
+			&size_read);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Failed to read stub section (%d)!", retval);
+			return retval;
+		}
+		retval = target_write_buffer(target,
+			section->base_address + sec_wr,
+			size_read,
+			buf);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Failed to write stub section!");
+			return retval;
+		}
+		sec_wr += size_read;
+	}
+	return ERROR_OK;
+}
+
 static int xtensa_stub_load(struct target *target,
 	struct xtensa_algo_image *algo_image,
 	struct xtensa_stub *stub,
@@ -159,39 +222,17 @@ static int xtensa_stub_load(struct target *target,
 					goto _on_error;
 				}
 			}
-			uint32_t sec_wr = 0;
-			uint8_t buf[512];
-			while (sec_wr < section->size) {
-				uint32_t nb = section->size - sec_wr >
-					sizeof(buf) ? sizeof(buf) : section->size - sec_wr;
-				size_t size_read = 0;
-				retval = image_read_section(&(algo_image->image),
-					i,
-					sec_wr,
-					nb,
-					buf,
-					&size_read);
-				if (retval != ERROR_OK) {
-					LOG_ERROR("Failed to read stub section (%d)!", retval);
-					goto _on_error;
-				}
-				retval = target_write_buffer(target,
-					section->base_address + sec_wr,
-					size_read,
-					buf);
-				if (retval != ERROR_OK) {
-					LOG_ERROR("Failed to write stub section!");
-					goto _on_error;
-				}
-				sec_wr += size_read;
-			}
+			retval = xtensa_stub_section_write(target, algo_image, i);
+			if (retval != ERROR_OK)
+				goto _on_error;
 		}
 	}
 	if (stub->tramp_addr == 0) {
 		/* alloc trampoline in code working area */
 		if (target_alloc_working_area(target, stub_tramp.size, &stub->tramp) != ERROR_OK) {
 			LOG_ERROR("no working area available, can't alloc space for stub jumper!");
-			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+			retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+			goto _on_error;
 		}
 		stub->tramp_addr = stub->tramp->address;
 	}
@@ -199,8 +240,8 @@ static int xtensa_stub_load(struct target *target,
 		/* alloc stack in data working area */
 		if (target_alloc_alt_working_area(target, stack_size, &stub->stack) != ERROR_OK) {
 			LOG_ERROR("no working area available, can't alloc stub stack!");
-			target_free_working_area(target, stub->tramp);
-			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+			retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+			goto _on_error;
 		}
 		stub->stack_addr = stub->stack->address + stack_size;
 	}
@@ -213,14 +254,7 @@ static int xtensa_stub_load(struct target *target,
 	return ERROR_OK;
 
 _on_error:
-	if (stub->tramp)
-		target_free_working_area(target, stub->tramp);
-	if (stub->stack)
-		target_free_alt_working_area(target, stub->stack);
-	if (stub->code)
-		target_free_working_area(target, stub->code);
-	if (stub->data)
-		target_free_alt_working_area(target, stub->data);
+	xtensa_stub_areas_free(target, stub);
 	return retval;
 }
 
@@ -232,14 +266,128 @@ static void xtensa_stub_cleanup(struct target *target, struct xtensa_stub *stub)
 	destroy_reg_param(&stub->reg_params[2]);
 	destroy_reg_param(&stub->reg_params[1]);
 	destroy_reg_param(&stub->reg_params[0]);
-	if (stub->tramp)
-		target_free_working_area(target, stub->tramp);
-	if (stub->stack)
-		target_free_alt_working_area(target, stub->stack);
-	if (stub->code)
-		target_free_working_area(target, stub->code);
-	if (stub->data)
-		target_free_alt_working_area(target, stub->data);
+	xtensa_stub_areas_free(target, stub);
+}
+
+void xtensa_algo_resident_release(struct target *target)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+	struct xtensa_stub_resident *resident = xtensa->stub_resident;
+
+	if (!resident)
+		return;
+	LOG_DEBUG("%s: release resident stub", target_name(target));
+	xtensa_stub_areas_free(target, &resident->stub);
+	if (resident->stub.tramp || resident->stub.stack || resident->stub.code ||
+		resident->stub.data) {
+		/* working areas keep pointers to our struct, so it can not be freed, try next time */
+		LOG_WARNING("%s: Failed to free resident stub working areas!", target_name(target));
+		return;
+	}
+	xtensa->stub_resident = NULL;
+	free(resident);
+}
+
+static bool xtensa_stub_resident_match(struct xtensa_stub_resident *resident,
+	struct xtensa_algo_image *algo_image)
+{
+	/* working areas could be freed by somebody else, e.g. on working area re-configuration */
+	if (!resident->stub.tramp || !resident->stub.stack)
+		return false;
+	if (resident->stub.entry != algo_image->image.start_address ||
+		resident->bss_size != algo_image->bss_size ||
+		resident->num_sections != algo_image->image.num_sections)
+		return false;
+	for (int i = 0; i < algo_image->image.num_sections; i++) {
+		struct imagesection *section = &algo_image->image.sections[i];
+		if (resident->sections[i].base_address != section->base_address ||
+			resident->sections[i].size != section->size ||
+			resident->sections[i].flags != section->flags)
+			return false;
+		if (!(section->flags & IMAGE_ELF_PHF_EXEC ? resident->stub.code : resident->stub.data))
+			return false;
+	}
+	return true;
+}
+
+static int xtensa_stub_resident_load(struct target *target,
+	struct xtensa_algo_image *algo_image,
+	struct xtensa_stub *stub,
+	uint32_t stack_size)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+	struct xtensa_stub_resident *resident = xtensa->stub_resident;
+
+	if (resident && !xtensa_stub_resident_match(resident, algo_image)) {
+		LOG_DEBUG("%s: resident stub does not match, reload it", target_name(target));
+		xtensa_algo_resident_release(target);
+		if (xtensa->stub_resident)
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		resident = NULL;
+	}
+	if (!resident) {
+		if (algo_image->image.num_sections > XTENSA_STUB_RESIDENT_SECT_MAX) {
+			LOG_DEBUG("Too many sections (%d) in resident stub!", algo_image->image.num_sections);
+			return xtensa_stub_load(target, algo_image, stub, stack_size);
+		}
+		resident = calloc(1, sizeof(*resident));
+		if (!resident) {
+			LOG_ERROR("Failed to alloc memory for resident stub!");
+			return ERROR_FAIL;
+		}
+		/* remember layout before loading, it updates sections base addresses */
+		resident->bss_size = algo_image->bss_size;
+		resident->num_sections = algo_image->image.num_sections;
+		for (int i = 0; i < algo_image->image.num_sections; i++) {
+			resident->sections[i].base_address = algo_image->image.sections[i].base_address;
+			resident->sections[i].size = algo_image->image.sections[i].size;
+			resident->sections[i].flags = algo_image->image.sections[i].flags;
+		}
+		int retval = xtensa_stub_load(target, algo_image, &resident->stub, stack_size);
+		if (retval != ERROR_OK) {
+			if (resident->stub.tramp || resident->stub.stack || resident->stub.code ||
+				resident->stub.data)
+				/* let release to free the rest later */
+				xtensa->stub_resident = resident;
+			else
+				free(resident);
+			return retval;
+		}
+		resident->stack_size = stack_size;
+		xtensa->stub_resident = resident;
+	} else {
+		LOG_DEBUG("%s: use resident stub", target_name(target));
+		/* code is not changed by stub, but initialized data can be, so reload them.
+		 * BSS is cleared by stub itself on every start. */
+		for (int i = 0; i < algo_image->image.num_sections; i++) {
+			struct imagesection *section = &algo_image->image.sections[i];
+			if (section->flags & IMAGE_ELF_PHF_EXEC)
+				continue;
+			if (section->base_address == 0)
+				section->base_address = resident->stub.data->address;
+			int retval = xtensa_stub_section_write(target, algo_image, i);
+			if (retval != ERROR_OK) {
+				xtensa_algo_resident_release(target);
+				return retval;
+			}
+		}
+		if (resident->stack_size < stack_size) {
+			target_free_alt_working_area(target, resident->stub.stack);
+			if (target_alloc_alt_working_area(target, stack_size,
+					&resident->stub.stack) != ERROR_OK) {
+				LOG_ERROR("no working area available, can't alloc stub stack!");
+				xtensa_algo_resident_release(target);
+				return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+			}
+			resident->stub.stack_addr = resident->stub.stack->address + stack_size;
+			resident->stack_size = stack_size;
+		}
+	}
+	/* working areas are owned by resident stub, do not free them after run */
+	stub->entry = resident->stub.entry;
+	stub->tramp_addr = resident->stub.tramp_addr;
+	stub->stack_addr = resident->stub.stack_addr;
+	return ERROR_OK;
 }
 
 #if XTENSA_STUB_STACK_DEBUG
@@ -318,7 +466,14 @@ static int xtensa_algo_run(struct target *target, struct xtensa_algo_image *imag
 		return ERROR_FAIL;
 	}
 
-	retval = xtensa_stub_load(target, image, &run->priv.stub, run->stack_size);
+	if (image && run->stub_resident)
+		retval = xtensa_stub_resident_load(target, image, &run->priv.stub, run->stack_size);
+	else {
+		/* resident stub occupies working areas */
+		if (image)
+			xtensa_algo_resident_release(target);
+		retval = xtensa_stub_load(target, image, &run->priv.stub, run->stack_size);
+	}
 	if (retval != ERROR_OK) {
 		LOG_ERROR("Failed to load stub (%d)!", retval);
 		return retval;
@@ -442,6 +597,9 @@ static int xtensa_algo_run(struct target *target, struct xtensa_algo_image *imag
 	if (retval != ERROR_OK) {
 		LOG_ERROR("Failed to wait algorithm (%d)!", retval);
 		/* target has been forced to stop in target_wait_algorithm() */
+		/* stub state is unknown, do not re-use it */
+		if (image && run->stub_resident)
+			xtensa_algo_resident_release(target);
 	}
 #if XTENSA_STUB_STACK_DEBUG
 	retval = xtensa_stub_check_stack(target,
@@ -99,6 +99,20 @@
  *
  * For example on how to execute external code with memory arguments @see esp32_blank_check in ESP32 flash driver.
  *
+ * Resident Stubs
+ * --------------
+ * Loading stub code and data takes considerable time, so when xtensa_algo_run_data.stub_resident is set
+ * stub is not unloaded after run. Its code, trampoline and stack stay in working areas and are re-used
+ * by the next run of the same image. Data sections are written again from the image before every run, so
+ * writable static data start with their initial values as with non-resident stub. Memory arguments and buffers allocated by user functions are still
+ * allocated and freed per run. Resident stub is released when:
+ * - target is resumed by user or reset,
+ * - another image or non-resident run needs working areas,
+ * - stub run fails,
+ * - xtensa_algo_resident_release() is called explicitly.
+ * BSS is not re-loaded, it is cleared by stub itself. Also note that with working area backup enabled target
+ * memory under resident stub is restored only when stub is released.
+ *
  * On-Board Code Execution
  * -----------------------
  * To run on-board code on ESP32 user should use xtensa_run_onboard_func() or xtensa_run_algorithm_onboard().
@@ -270,6 +284,8 @@ struct xtensa_algo_run_data {
 	int32_t ret_code;
 	/** Algorithm run function: esp32_run_algorithm_xxx. */
 	xtensa_algo_func_t algo_func;
+	/** Keep external stub loaded on target after run. @see xtensa_algo_resident_release() */
+	bool stub_resident;
 	/* user should init to zero the following fields and should not use them anyhow else.
 	 * only for internal uses */
 	struct {
@@ -308,6 +324,14 @@ static inline int xtensa_run_func_image(struct target *target,
 	return retval;
 }
 
+/**
+ * @brief Unloads resident stub and frees its working areas.
+ *        Does nothing if there is no resident stub on target.
+ *
+ * @param target Pointer to target.
+ */
+void xtensa_algo_resident_release(struct target *target);
+
 /**
  * @brief Runs pre-compiled on-board function.
  *        This function should be used to run on-board stub code.
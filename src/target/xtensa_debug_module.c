@@ -39,6 +39,10 @@ static void xtensa_dm_add_set_ir(struct xtensa_debug_module *dm, uint8_t value)
 	struct scan_field field;
 	uint8_t t[4];
 
+	/* JTAG core tracks current instruction of every TAP, it is reset to BYPASS on TAP reset
+	 * and when IR scan for another TAP in the chain is queued. So skip redundant IR scans. */
+	if (buf_get_u32(dm->tap->cur_instr, 0, dm->tap->ir_length) == value)
+		return;
 	memset(&field, 0, sizeof field);
 	field.num_bits = dm->tap->ir_length;
 	field.out_value = t;
@@ -71,6 +75,15 @@ int xtensa_dm_init(struct xtensa_debug_module *dm, const struct xtensa_debug_mod
 	return ERROR_OK;
 }
 
+void xtensa_dm_ir_cache_invalidate(void)
+{
+	/* Current IR contents are unknown. Pretend that all TAPs are in BYPASS, so the next
+	 * access to any other instruction rescans IR. */
+	for (struct jtag_tap *tap = jtag_tap_next_enabled(NULL); tap;
+		tap = jtag_tap_next_enabled(tap))
+		buf_set_ones(tap->cur_instr, tap->ir_length);
+}
+
 int xtensa_dm_queue_enable(struct xtensa_debug_module *dm)
 {
 	return dm->dbg_ops->queue_reg_write(dm, NARADR_DCRSET, OCDDCR_ENABLEOCD);
@@ -151,49 +164,75 @@ int xtensa_dm_queue_pwr_reg_write(struct xtensa_debug_module *dm, unsigned reg,
 	return ERROR_OK;
 }
 
-int xtensa_dm_device_id_read(struct xtensa_debug_module *dm)
+/* Queued status reads allow to read several debug modules with a single JTAG queue execution.
+ * Results are available after the queue is executed and xtensa_dm_*_update() is called. */
+/* DEBUGPC holds the PC of the running core, reading it does not disturb the core */
+int xtensa_dm_queue_debug_pc_read(struct xtensa_debug_module *dm, uint8_t *value)
+{
+	return dm->dbg_ops->queue_reg_read(dm, NARADR_DEBUGPC, value);
+}
+
+int xtensa_dm_queue_device_id_read(struct xtensa_debug_module *dm)
+{
+	return dm->dbg_ops->queue_reg_read(dm, NARADR_OCDID, dm->device_id_buf);
+}
+
+void xtensa_dm_device_id_update(struct xtensa_debug_module *dm)
 {
-	uint8_t id_buf[sizeof(uint32_t)];
+	dm->device_id = buf_get_u32(dm->device_id_buf, 0, 32);
+}
 
-	dm->dbg_ops->queue_reg_read(dm, NARADR_OCDID, id_buf);
+int xtensa_dm_device_id_read(struct xtensa_debug_module *dm)
+{
+	xtensa_dm_queue_device_id_read(dm);
 	xtensa_dm_queue_tdi_idle(dm);
 	int res = jtag_execute_queue();
 	if (res != ERROR_OK)
 		return res;
-	dm->device_id = buf_get_u32(id_buf, 0, 32);
+	xtensa_dm_device_id_update(dm);
 	return ERROR_OK;
 }
 
-int xtensa_dm_power_status_read(struct xtensa_debug_module *dm, uint32_t clear)
+int xtensa_dm_queue_power_status_read(struct xtensa_debug_module *dm, uint32_t clear)
 {
-	/* uint8_t id_buf[sizeof(uint32_t)]; */
-
 	/* TODO: JTAG does not work when PWRCTL_JTAGDEBUGUSE is not set. */
 	/*       It is set in xtensa_examine(), need to move reading of NARADR_OCDID out of this
 	 * function */
-	/* dm->dbg_ops->queue_reg_read(dm, NARADR_OCDID, id_buf);
-	 *Read reset state */
-	dm->pwr_ops->queue_reg_read(dm, DMREG_PWRSTAT, &dm->power_status.stat, clear);
-	dm->pwr_ops->queue_reg_read(dm, DMREG_PWRSTAT, &dm->power_status.stath, clear);
+	/*Read reset state */
+	int res = dm->pwr_ops->queue_reg_read(dm, DMREG_PWRSTAT, &dm->power_status.stat, clear);
+	if (res != ERROR_OK)
+		return res;
+	return dm->pwr_ops->queue_reg_read(dm, DMREG_PWRSTAT, &dm->power_status.stath, clear);
+}
+
+int xtensa_dm_power_status_read(struct xtensa_debug_module *dm, uint32_t clear)
+{
+	xtensa_dm_queue_power_status_read(dm, clear);
 	xtensa_dm_queue_tdi_idle(dm);
-	int res = jtag_execute_queue();
+	return jtag_execute_queue();
+}
+
+int xtensa_dm_queue_core_status_read(struct xtensa_debug_module *dm)
+{
+	int res = xtensa_dm_queue_enable(dm);
 	if (res != ERROR_OK)
 		return res;
-	/* dm->device_id = buf_get_u32(id_buf, 0, 32); */
-	return ERROR_OK;
+	return dm->dbg_ops->queue_reg_read(dm, NARADR_DSR, dm->core_status.dsr_buf);
 }
 
-int xtensa_dm_core_status_read(struct xtensa_debug_module *dm)
+void xtensa_dm_core_status_update(struct xtensa_debug_module *dm)
 {
-	uint8_t dsr_buf[sizeof(uint32_t)];
+	dm->core_status.dsr = buf_get_u32(dm->core_status.dsr_buf, 0, 32);
+}
 
-	xtensa_dm_queue_enable(dm);
-	dm->dbg_ops->queue_reg_read(dm, NARADR_DSR, dsr_buf);
+int xtensa_dm_core_status_read(struct xtensa_debug_module *dm)
+{
+	xtensa_dm_queue_core_status_read(dm);
 	xtensa_dm_queue_tdi_idle(dm);
 	int res = jtag_execute_queue();
 	if (res != ERROR_OK)
 		return res;
-	dm->core_status.dsr = buf_get_u32(dsr_buf, 0, 32);
+	xtensa_dm_core_status_update(dm);
 	return res;
 }
 
@@ -340,24 +379,64 @@ int xtensa_dm_perfmon_enable(struct xtensa_debug_module *dm, int counter_id,
 int xtensa_dm_perfmon_dump(struct xtensa_debug_module *dm, int counter_id,
 	struct xtensa_perfmon_result *out_result)
 {
-	uint8_t pmstat_buf[4];
-	uint8_t pmcount_buf[4];
-
-	dm->dbg_ops->queue_reg_read(dm, NARADR_PMSTAT0 + counter_id, pmstat_buf);
-	dm->dbg_ops->queue_reg_read(dm, NARADR_PM0 + counter_id, pmcount_buf);
-	xtensa_dm_queue_tdi_idle(dm);
-	int res = jtag_execute_queue();
-	if (res != ERROR_OK)
-		return res;
-
-	uint32_t stat = buf_get_u32(pmstat_buf, 0, 32);
-	uint64_t result = buf_get_u32(pmcount_buf, 0, 32);
-
-	/* TODO: if counter # counter_id+1 has 'select' set to 1, use its value as the
-	 * high 32 bits of the counter. */
+	struct xtensa_perfmon_counters_buf buf;
+	struct xtensa_perfmon_result results[XTENSA_MAX_PERF_COUNTERS];
+
+	/* all counters are read to find out whether the requested one is chained with the next one */
+	for (int i = 0; i < XTENSA_PERFMON_READ_RETRIES; i++) {
+		xtensa_dm_queue_perfmon_counters_read(dm, &buf);
+		xtensa_dm_queue_tdi_idle(dm);
+		int res = jtag_execute_queue();
+		if (res != ERROR_OK)
+			return res;
+		if (xtensa_dm_perfmon_counters_get(&buf, results)) {
+			*out_result = results[counter_id];
+			return ERROR_OK;
+		}
+	}
+	LOG_ERROR("Failed to read consistent value of chained perfmon counters!");
+	return ERROR_FAIL;
+}
 
-	out_result->overflow = ((stat & 1) != 0);
-	out_result->value = result;
+void xtensa_dm_queue_perfmon_counters_read(struct xtensa_debug_module *dm,
+	struct xtensa_perfmon_counters_buf *buf)
+{
+	for (int i = 0; i < XTENSA_MAX_PERF_COUNTERS; i++) {
+		dm->dbg_ops->queue_reg_read(dm, NARADR_PMCTRL0 + i, buf->ctrl[i]);
+		dm->dbg_ops->queue_reg_read(dm, NARADR_PMSTAT0 + i, buf->stat[i]);
+		dm->dbg_ops->queue_reg_read(dm, NARADR_PM0 + i, buf->count[i]);
+	}
+	for (int i = 0; i < XTENSA_MAX_PERF_COUNTERS; i++)
+		dm->dbg_ops->queue_reg_read(dm, NARADR_PM0 + i, buf->count_recheck[i]);
+}
 
-	return ERROR_OK;
+/* Returns false if the high word of some chained counter has changed while its low word was read,
+ * the counters should be read again in this case. */
+bool xtensa_dm_perfmon_counters_get(const struct xtensa_perfmon_counters_buf *buf,
+	struct xtensa_perfmon_result out_results[XTENSA_MAX_PERF_COUNTERS])
+{
+	bool consistent = true;
+
+	for (int i = 0; i < XTENSA_MAX_PERF_COUNTERS; i++) {
+		struct xtensa_perfmon_result *result = &out_results[i];
+		uint32_t stat = buf_get_u32(buf->stat[i], 0, 32);
+
+		result->value = buf_get_u32(buf->count_recheck[i], 0, 32);
+		result->overflow = ((stat & 1) != 0);
+		result->chained = false;
+		if (i + 1 < XTENSA_MAX_PERF_COUNTERS) {
+			uint32_t next_select = (buf_get_u32(buf->ctrl[i + 1], 0, 32) >> 8) & 0x1f;
+			if (next_select == XTENSA_PERF_SELECT_OVERFLOW) {
+				/* the next counter counts overflows of this one */
+				uint32_t next_stat = buf_get_u32(buf->stat[i + 1], 0, 32);
+				uint32_t high = buf_get_u32(buf->count_recheck[i + 1], 0, 32);
+				if (buf_get_u32(buf->count[i + 1], 0, 32) != high)
+					consistent = false;
+				result->value |= (uint64_t)high << 32;
+				result->overflow = ((next_stat & 1) != 0);
+				result->chained = true;
+			}
+		}
+	}
+	return consistent;
 }
@@ -69,6 +69,7 @@
 #define NARADR_DELAYCNT     0x07
 #define NARADR_MEMADDRSTART 0x08
 #define NARADR_MEMADDREND   0x09
+#define NARADR_DEBUGPC      0x0F
 /*Performance monitor registers */
 #define NARADR_PMG          0x20
 #define NARADR_INTPC        0x24
@@ -215,8 +216,12 @@
 					/*out-of-range */
 
 #define XTENSA_MAX_PERF_COUNTERS    2
+/* attempts to read chained counters while low word carries into high one */
+#define XTENSA_PERFMON_READ_RETRIES 3
 #define XTENSA_MAX_PERF_SELECT      32
 #define XTENSA_MAX_PERF_MASK        0xffff
+/* counter with this 'select' value counts overflows of the previous one, i.e. holds its high 32 bits */
+#define XTENSA_PERF_SELECT_OVERFLOW 1
 
 struct xtensa_debug_module;
 
@@ -257,6 +262,7 @@ struct xtensa_power_status {
 
 struct xtensa_core_status {
 	xtensa_dsr_t dsr;
+	uint8_t dsr_buf[sizeof(uint32_t)];	/* destination of the queued read */
 };
 
 struct xtensa_trace_config {
@@ -287,6 +293,18 @@ struct xtensa_perfmon_config {
 struct xtensa_perfmon_result {
 	uint64_t value;
 	bool overflow;
+	/* high 32 bits of the value are taken from the next counter */
+	bool chained;
+};
+
+/* Raw values of all counters read in one go */
+struct xtensa_perfmon_counters_buf {
+	uint8_t ctrl[XTENSA_MAX_PERF_COUNTERS][4];
+	uint8_t stat[XTENSA_MAX_PERF_COUNTERS][4];
+	uint8_t count[XTENSA_MAX_PERF_COUNTERS][4];
+	/* counters read once more after all of the above, for chained counters the low word is
+	 * taken from here and the high word is read before and after it */
+	uint8_t count_recheck[XTENSA_MAX_PERF_COUNTERS][4];
 };
 
 struct xtensa_debug_module_config {
@@ -307,10 +325,13 @@ struct xtensa_debug_module {
 	struct xtensa_power_status power_status;
 	struct xtensa_core_status core_status;
 	xtensa_ocdid_t device_id;
+	uint8_t device_id_buf[sizeof(uint32_t)];	/* destination of the queued read */
 };
 
 
 int xtensa_dm_init(struct xtensa_debug_module *dm, const struct xtensa_debug_module_config *cfg);
+/* Must be called after raw IR scans which are not tracked by JTAG core, e.g. jtag_add_plain_ir_scan() */
+void xtensa_dm_ir_cache_invalidate(void);
 int xtensa_dm_queue_enable(struct xtensa_debug_module *dm);
 int xtensa_dm_queue_reg_read(struct xtensa_debug_module *dm, unsigned reg, uint8_t *value);
 int xtensa_dm_queue_reg_write(struct xtensa_debug_module *dm, unsigned reg, uint32_t value);
@@ -325,6 +346,7 @@ static inline void xtensa_dm_queue_tdi_idle(struct xtensa_debug_module *dm)
 	dm->queue_tdi_idle(dm->queue_tdi_idle_arg);
 }
 
+int xtensa_dm_queue_power_status_read(struct xtensa_debug_module *dm, uint32_t clear);
 int xtensa_dm_power_status_read(struct xtensa_debug_module *dm, uint32_t clear);
 static inline void xtensa_dm_power_status_cache_reset(struct xtensa_debug_module *dm)
 {
@@ -339,6 +361,8 @@ static inline xtensa_pwrstat_t xtensa_dm_power_status_get(struct xtensa_debug_mo
 	return dm->power_status.stath;
 }
 
+int xtensa_dm_queue_core_status_read(struct xtensa_debug_module *dm);
+void xtensa_dm_core_status_update(struct xtensa_debug_module *dm);
 int xtensa_dm_core_status_read(struct xtensa_debug_module *dm);
 int xtensa_dm_core_status_clear(struct xtensa_debug_module *dm, xtensa_dsr_t bits);
 int xtensa_dm_core_status_check(struct xtensa_debug_module *dm);
@@ -352,12 +376,21 @@ static inline bool xtensa_dm_core_is_stalled(struct xtensa_debug_module *dm)
 	return dm->core_status.dsr & OCDDSR_RUNSTALLSAMPLE;
 }
 
+int xtensa_dm_queue_debug_pc_read(struct xtensa_debug_module *dm, uint8_t *value);
+int xtensa_dm_queue_device_id_read(struct xtensa_debug_module *dm);
+void xtensa_dm_device_id_update(struct xtensa_debug_module *dm);
 int xtensa_dm_device_id_read(struct xtensa_debug_module *dm);
 static inline xtensa_ocdid_t xtensa_dm_device_id_get(struct xtensa_debug_module *dm)
 {
 	return dm->device_id;
 }
 
+/* Checks cached device ID, all zeroes or ones mean that the core does not respond */
+static inline bool xtensa_dm_device_id_valid(struct xtensa_debug_module *dm)
+{
+	return dm->device_id != 0xffffffff && dm->device_id != 0;
+}
+
 int xtensa_dm_trace_start(struct xtensa_debug_module *dm, struct xtensa_trace_start_config *cfg);
 int xtensa_dm_trace_stop(struct xtensa_debug_module *dm);
 int xtensa_dm_trace_config_read(struct xtensa_debug_module *dm, struct xtensa_trace_config *config);
@@ -369,7 +402,7 @@ static inline bool xtensa_dm_is_online(struct xtensa_debug_module *dm)
 	int res = xtensa_dm_device_id_read(dm);
 	if (res != ERROR_OK)
 		return false;
-	return (dm->device_id != 0xffffffff && dm->device_id != 0);
+	return xtensa_dm_device_id_valid(dm);
 }
 
 static inline bool xtensa_dm_tap_was_reset(struct xtensa_debug_module *dm)
@@ -388,5 +421,9 @@ int xtensa_dm_perfmon_enable(struct xtensa_debug_module *dm, int counter_id,
 	const struct xtensa_perfmon_config *config);
 int xtensa_dm_perfmon_dump(struct xtensa_debug_module *dm, int counter_id,
 	struct xtensa_perfmon_result *out_result);
+void xtensa_dm_queue_perfmon_counters_read(struct xtensa_debug_module *dm,
+	struct xtensa_perfmon_counters_buf *buf);
+bool xtensa_dm_perfmon_counters_get(const struct xtensa_perfmon_counters_buf *buf,
+	struct xtensa_perfmon_result out_results[XTENSA_MAX_PERF_COUNTERS]);
 
 #endif	/*__XTENSA_DEBUG_MODULE_H__*/
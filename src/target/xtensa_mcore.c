@@ -25,6 +25,7 @@
 #include "target.h"
 #include "target_type.h"
 #include "xtensa_mcore.h"
+#include "xtensa_trax.h"
 
 
 int xtensa_mcore_assert_reset(struct target *target)
@@ -265,6 +266,32 @@ int xtensa_mcore_checksum_memory(struct target *target,
 	return sub_target->type->checksum_memory(sub_target, address, count, checksum);
 }
 
+/* PC samples of all cores are collected to the same buffer */
+int xtensa_mcore_profiling(struct target *target, uint32_t *samples,
+	uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+{
+	struct xtensa_mcore_common *xtensa_mcore = target_to_xtensa_mcore(target);
+	int retval = ERROR_OK;
+
+	LOG_INFO("Starting Xtensa profiling on %d cores. Sampling DEBUGPC as fast as we can...",
+		(int)xtensa_mcore->configured_cores_num);
+	/* Make sure the target is running */
+	target_poll(target);
+	if (target->state == TARGET_HALTED)
+		retval = target_resume(target, 1, 0, 0, 0);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error while resuming target");
+		return retval;
+	}
+
+	return xtensa_profiling_sample_pc(xtensa_mcore->cores_targets,
+		xtensa_mcore->configured_cores_num,
+		samples,
+		max_num_samples,
+		num_samples,
+		seconds);
+}
+
 int xtensa_mcore_get_gdb_reg_list(struct target *target,
 	struct reg **reg_list[],
 	int *reg_list_size,
@@ -377,6 +404,22 @@ int xtensa_mcore_init_arch_info(struct target *target, struct xtensa_mcore_commo
 	return ERROR_OK;
 }
 
+/* Marks target as offline and resets cached power status of all cores */
+static void xtensa_mcore_set_offline(struct target *target)
+{
+	struct xtensa_mcore_common *xtensa_mcore = target_to_xtensa_mcore(target);
+
+	if (target->state != TARGET_UNKNOWN) {
+		LOG_INFO("%s: Target offline", target_name(target));
+		target->state = TARGET_UNKNOWN;
+	}
+	for (uint8_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
+		struct xtensa *xtensa = target_to_xtensa(&xtensa_mcore->cores_targets[i]);
+		xtensa_dm_power_status_cache_reset(&xtensa->dbg_mod);
+	}
+	xtensa_mcore->core_poweron_mask = 0;
+}
+
 /* TODO: refactor this function into smaller ones */
 int xtensa_mcore_poll(struct target *target)
 {
@@ -384,24 +427,33 @@ int xtensa_mcore_poll(struct target *target)
 	bool need_resume = false;
 	int res;
 
+	/* Read IDs and power status of all cores with a single JTAG queue execution */
+	struct xtensa *xtensa0 = target_to_xtensa(&xtensa_mcore->cores_targets[0]);
+	for (uint8_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
+		struct xtensa *xtensa = target_to_xtensa(&xtensa_mcore->cores_targets[i]);
+		xtensa_dm_queue_device_id_read(&xtensa->dbg_mod);
+		xtensa_dm_queue_power_status_read(&xtensa->dbg_mod,
+			PWRSTAT_DEBUGWASRESET|PWRSTAT_COREWASRESET);
+	}
+	xtensa_dm_queue_tdi_idle(&xtensa0->dbg_mod);
+	res = jtag_execute_queue();
+	if (res != ERROR_OK) {
+		LOG_ERROR("%s: Failed to read cores IDs and power status (%d)!", target_name(target), res);
+		xtensa_mcore_set_offline(target);
+		return res;
+	}
+
 	uint32_t core_poweron_mask = 0;
 	for (uint8_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
 		struct xtensa *xtensa = target_to_xtensa(&xtensa_mcore->cores_targets[i]);
-		if (xtensa_dm_is_online(&xtensa->dbg_mod))
+		xtensa_dm_device_id_update(&xtensa->dbg_mod);
+		if (xtensa_dm_device_id_valid(&xtensa->dbg_mod))
 			core_poweron_mask |= (1 << i);
 	}
 	/* Target might be held in reset by external signal.
 	 * Sanity check target responses using idcode (checking CPU0 is sufficient). */
 	if (core_poweron_mask == 0) {
-		if (target->state != TARGET_UNKNOWN) {
-			LOG_INFO("%s: Target offline", __func__);
-			target->state = TARGET_UNKNOWN;
-		}
-		for (uint8_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
-			struct xtensa *xtensa = target_to_xtensa(&xtensa_mcore->cores_targets[i]);
-			xtensa_dm_power_status_cache_reset(&xtensa->dbg_mod);
-		}
-		xtensa_mcore->core_poweron_mask = 0;
+		xtensa_mcore_set_offline(target);
 		LOG_ERROR("%s: Target failure", __func__);
 		return ERROR_TARGET_FAILURE;
 	}
@@ -412,10 +464,6 @@ int xtensa_mcore_poll(struct target *target)
 
 	for (size_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
 		struct xtensa *xtensa = target_to_xtensa(&xtensa_mcore->cores_targets[i]);
-		res = xtensa_dm_power_status_read(&xtensa->dbg_mod,
-			PWRSTAT_DEBUGWASRESET|PWRSTAT_COREWASRESET);
-		if (res != ERROR_OK)
-			return res;
 		if (xtensa_dm_tap_was_reset(&xtensa->dbg_mod)) {
 			LOG_INFO("%s: Debug controller %d was reset.", target_name(target), (int)i);
 			xtensa_mcore->core_poweron_mask &= ~(1 << i);
@@ -428,20 +476,34 @@ int xtensa_mcore_poll(struct target *target)
 		}
 		xtensa_dm_power_status_cache(&xtensa->dbg_mod);
 		/*Enable JTAG, set reset if needed */
-		res = xtensa_wakeup(&xtensa_mcore->cores_targets[i]);
+		xtensa_queue_wakeup(&xtensa_mcore->cores_targets[i]);
+	}
+
+	if (cores_came_online != 0) {
+		xtensa_dm_queue_tdi_idle(&xtensa0->dbg_mod);
+		res = jtag_execute_queue();
 		if (res != ERROR_OK)
 			return res;
+		for (size_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
+			if (cores_came_online & (1 << i)) {
+				LOG_DEBUG("%s: Core %d came online, setting up DCR", __func__, (int) i);
+				xtensa_mcore_smpbreak_set_core(xtensa_mcore, i);
+			}
+		}
 	}
 
+	/* wakeup requests (if not executed yet) and core status reads go in one JTAG queue execution */
 	for (size_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
 		struct xtensa *xtensa = target_to_xtensa(&xtensa_mcore->cores_targets[i]);
-		if (cores_came_online & (1 << i)) {
-			LOG_DEBUG("%s: Core %d came online, setting up DCR", __func__, (int) i);
-			xtensa_mcore_smpbreak_set_core(xtensa_mcore, i);
-		}
-		res = xtensa_dm_core_status_read(&xtensa->dbg_mod);
-		if (res != ERROR_OK)
-			return res;
+		xtensa_dm_queue_core_status_read(&xtensa->dbg_mod);
+	}
+	xtensa_dm_queue_tdi_idle(&xtensa0->dbg_mod);
+	res = jtag_execute_queue();
+	if (res != ERROR_OK)
+		return res;
+	for (size_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
+		struct xtensa *xtensa = target_to_xtensa(&xtensa_mcore->cores_targets[i]);
+		xtensa_dm_core_status_update(&xtensa->dbg_mod);
 	}
 
 	xtensa_dsr_t common_core_stat = 0;
@@ -484,10 +546,54 @@ int xtensa_mcore_poll(struct target *target)
 			 * automatically. */
 			/* Should we stop the second CPU if BreakIn/BreakOut is not configured? */
 			target->state = TARGET_HALTED;
+			for (size_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
+				struct xtensa *xtensa = target_to_xtensa(&xtensa_mcore->cores_targets[i]);
+				gettimeofday(&xtensa->halt_time, NULL);
+				xtensa->fast_halt_done = false;
+			}
 			/*Examine why the target has been halted */
 			target->debug_reason = DBG_REASON_UNDEFINED;
+			bool core_regs_fetched = false;
+			if (oldstate != TARGET_DEBUG_RUNNING &&
+				xtensa_mcore->chip_ops->on_fast_halt != NULL) {
+				/* let the chip serve the requests from the target software (e.g.
+				 * semihosting) before reading the rest of registers */
+				core_regs_fetched = true;
+				for (size_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
+					if (xtensa_fetch_core_regs(&xtensa_mcore->cores_targets[i]) !=
+						ERROR_OK) {
+						core_regs_fetched = false;
+						break;
+					}
+					xtensa_mcore->cores_targets[i].state = TARGET_HALTED;
+					/* chip can reset it for the cores which need to be checked on
+					 * the regular halt */
+					target_to_xtensa(&xtensa_mcore->cores_targets[i])->fast_halt_done = true;
+				}
+				if (core_regs_fetched && xtensa_mcore->chip_ops->on_fast_halt(target)) {
+					/* active core has been selected by the chip */
+					for (size_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
+						struct xtensa *xtensa = target_to_xtensa(
+							&xtensa_mcore->cores_targets[i]);
+						xtensa_dm_core_status_clear(&xtensa->dbg_mod,
+							OCDDSR_DEBUGPENDBREAK|OCDDSR_DEBUGINTBREAK|
+							OCDDSR_DEBUGPENDHOST|OCDDSR_DEBUGINTHOST);
+					}
+					target->debug_reason = DBG_REASON_BREAKPOINT;
+					target->reg_cache =
+						xtensa_mcore->cores_targets[xtensa_mcore->active_core].reg_cache;
+					target->coreid = xtensa_mcore->active_core;
+					need_resume = true;
+					goto _poll_done;
+				}
+			}
 			for (size_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
-				xtensa_fetch_all_regs(&xtensa_mcore->cores_targets[i]);
+				if (core_regs_fetched) {
+					xtensa_fetch_rest_regs(&xtensa_mcore->cores_targets[i]);
+				} else {
+					target_to_xtensa(&xtensa_mcore->cores_targets[i])->fast_halt_done = false;
+					xtensa_fetch_halt_regs(&xtensa_mcore->cores_targets[i]);
+				}
 				xtensa_mcore->cores_targets[i].state = TARGET_HALTED;
 			}
 			/* When setting debug reason DEBUGCAUSE events have the followuing
@@ -626,6 +732,7 @@ int xtensa_mcore_poll(struct target *target)
 			target->debug_reason = DBG_REASON_NOTHALTED;
 		}
 	}
+_poll_done:
 	if (xtensa_mcore->chip_ops->on_poll != NULL)
 		xtensa_mcore->chip_ops->on_poll(target);
 	if (need_resume) {
@@ -787,6 +894,12 @@ int xtensa_mcore_run_func_image(struct target *target,
 	struct target *sub_target = &xtensa_mcore->cores_targets[xtensa_mcore->active_core];
 	va_list ap;
 
+	/* cores have separate working area pools over the same memory, so only one core can
+	 * keep resident stub */
+	for (size_t i = 0; i < xtensa_mcore->configured_cores_num; i++) {
+		if (i != xtensa_mcore->active_core)
+			xtensa_algo_resident_release(&xtensa_mcore->cores_targets[i]);
+	}
 	va_start(ap, num_args);
 	int retval = xtensa_run_func_image_va(sub_target, run, image, num_args, ap);
 	va_end(ap);
@@ -806,6 +919,14 @@ int xtensa_mcore_run_func_image(struct target *target,
 	return retval;
 }
 
+void xtensa_mcore_algo_resident_release(struct target *target)
+{
+	struct xtensa_mcore_common *xtensa_mcore = target_to_xtensa_mcore(target);
+
+	for (size_t i = 0; i < xtensa_mcore->configured_cores_num; i++)
+		xtensa_algo_resident_release(&xtensa_mcore->cores_targets[i]);
+}
+
 size_t xtensa_mcore_get_enabled_cores_count(struct target *target)
 {
 	struct xtensa_mcore_common *xtensa_mcore = target_to_xtensa_mcore(target);
@@ -887,6 +1008,24 @@ COMMAND_HANDLER(xtensa_mcore_cmd_permissive_mode)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(xtensa_mcore_cmd_lazy_regs)
+{
+	struct xtensa_mcore_common *xtensa_mcore = target_to_xtensa_mcore(get_current_target(
+			CMD_CTX));
+
+	if (CMD_ARGC == 0)
+		return CALL_COMMAND_HANDLER(xtensa_cmd_lazy_regs_do,
+			target_to_xtensa(&xtensa_mcore->cores_targets[0]));
+	for (int i = 0; i < xtensa_mcore->configured_cores_num; i++) {
+		int ret =
+			CALL_COMMAND_HANDLER(xtensa_cmd_lazy_regs_do,
+			target_to_xtensa(&xtensa_mcore->cores_targets[i]));
+		if (ret != ERROR_OK)
+			return ret;
+	}
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(xtensa_mcore_cmd_mask_interrupts)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -938,6 +1077,27 @@ COMMAND_HANDLER(xtensa_mcore_cmd_perfmon_dump)
 	return ERROR_OK;
 }
 
+/* perfmon_sample [<file> [period_ms] | stop] */
+COMMAND_HANDLER(xtensa_mcore_cmd_perfmon_sample)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct xtensa_mcore_common *xtensa_mcore = target_to_xtensa_mcore(target);
+	struct xtensa **cores = calloc(xtensa_mcore->configured_cores_num, sizeof(*cores));
+
+	if (!cores) {
+		LOG_ERROR("Failed to alloc memory for cores list!");
+		return ERROR_FAIL;
+	}
+	/* all cores are sampled together, sampler is kept by the first one */
+	for (size_t i = 0; i < xtensa_mcore->configured_cores_num; i++)
+		cores[i] = target_to_xtensa(&xtensa_mcore->cores_targets[i]);
+	int res = CALL_COMMAND_HANDLER(xtensa_cmd_perfmon_sample_do,
+		cores,
+		xtensa_mcore->configured_cores_num);
+	free(cores);
+	return res;
+}
+
 COMMAND_HANDLER(xtensa_mcore_cmd_tracestart)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -991,6 +1151,32 @@ COMMAND_HANDLER(xtensa_mcore_cmd_tracedump)
 	return ERROR_OK;
 }
 
+/* tracecapture [<file> [max_size] [pc <pcval>/[maskbitcount]] [after <n> [ins|words]] | stop]
+ * Every core is captured to its own file '<file>.cpuN'. */
+COMMAND_HANDLER(xtensa_mcore_cmd_tracecapture)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct xtensa_mcore_common *xtensa_mcore = target_to_xtensa_mcore(target);
+	bool start = CMD_ARGC > 0 && strcmp(CMD_ARGV[0], "stop") != 0;
+
+	for (int i = 0; i < xtensa_mcore->configured_cores_num; i++) {
+		char *fname = NULL;
+		if (start) {
+			fname = alloc_printf("%s.cpu%d", CMD_ARGV[0], i);
+			if (!fname) {
+				LOG_ERROR("Failed to alloc memory for trace file name!");
+				return ERROR_FAIL;
+			}
+		}
+		int res = CALL_COMMAND_HANDLER(xtensa_cmd_tracecapture_do,
+			target_to_xtensa(&xtensa_mcore->cores_targets[i]), fname);
+		free(fname);
+		if (res != ERROR_OK)
+			return res;
+	}
+	return ERROR_OK;
+}
+
 const struct command_registration xtensa_mcore_command_handlers[] = {
 	{
 		.name = "set_permissive",
@@ -999,6 +1185,14 @@ const struct command_registration xtensa_mcore_command_handlers[] = {
 		.help = "When set to 1, enable ESP108 permissive mode (less client-side checks)",
 		.usage = "[0|1]",
 	},
+	{
+		.name = "lazy_regs",
+		.handler = xtensa_mcore_cmd_lazy_regs,
+		.mode = COMMAND_ANY,
+		.help = "When set to 1, read only PC, PS, DEBUGCAUSE, EXCCAUSE, WINDOWBASE and A0-A15 "
+			"on halt, other registers are read on the first access",
+		.usage = "[0|1]",
+	},
 	{
 		.name = "maskisr",
 		.handler = xtensa_mcore_cmd_mask_interrupts,
@@ -1029,6 +1223,14 @@ const struct command_registration xtensa_mcore_command_handlers[] = {
 			"Dump performance counter value. If no argument specified, dumps all counters.",
 		.usage = "[counter_id]",
 	},
+	{
+		.name = "perfmon_sample",
+		.handler = xtensa_mcore_cmd_perfmon_sample,
+		.mode = COMMAND_EXEC,
+		.help =
+			"Periodically read all performance counters of all cores and write timestamped values to CSV file. Without arguments shows sampling status.",
+		.usage = "[<file> [period_ms] | 'stop']",
+	},
 	{
 		.name = "tracestart",
 		.handler = xtensa_mcore_cmd_tracestart,
@@ -1051,5 +1253,19 @@ const struct command_registration xtensa_mcore_command_handlers[] = {
 		.help = "Tracing: Dump trace memory to a files. One file per core.",
 		.usage = "<outfile1> [outfile2 ... outfileN]",
 	},
+	{
+		.name = "tracecapture",
+		.handler = xtensa_mcore_cmd_tracecapture,
+		.mode = COMMAND_EXEC,
+		.help =
+			"Tracing: Continuously capture trace of all cores. TRAX is re-armed on every trace stop and its memory is appended to per-core file '<file>.cpuN', which is rotated to '<file>.cpuN.1' when max_size (bytes, default 16MB) is reached. Without arguments shows capture status.",
+		.usage =
+			"[<file> [max_size] [pc <pcval>/[maskbitcount]] [after <n> [ins|words]] | 'stop']",
+	},
+	{
+		.mode = COMMAND_ANY,
+		.usage = "",
+		.chain = xtensa_trax_command_handlers,
+	},
 	COMMAND_REGISTRATION_DONE
 };
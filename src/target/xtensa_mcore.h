@@ -117,6 +117,8 @@ int xtensa_mcore_checksum_memory(struct target *target,
 	target_addr_t address,
 	uint32_t count,
 	uint32_t *checksum);
+int xtensa_mcore_profiling(struct target *target, uint32_t *samples,
+	uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds);
 size_t xtensa_mcore_get_enabled_cores_count(struct target *target);
 size_t xtensa_mcore_get_active_core(struct target *target);
 void xtensa_mcore_set_active_core(struct target *target, size_t core);
@@ -160,5 +162,6 @@ int xtensa_mcore_run_func_image(struct target *target,
 	struct xtensa_algo_image *image,
 	uint32_t num_args,
 	...);
+void xtensa_mcore_algo_resident_release(struct target *target);
 
 #endif	/* XTENSA_MCORE_H */
@@ -0,0 +1,373 @@
+/***************************************************************************
+ *   Xtensa TRAX trace decoder for OpenOCD                                 *
+ *   Copyright (C) 2019 Espressif Systems Ltd.                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+/* TRAX stores program trace as a stream of Nexus-like messages. Every byte carries 6 bits of
+ * message data (MDO, bits 7..2) and 2 bits of message start/end info (MSEO, bits 1..0):
+ * 00 - message continues, 01 - end of variable length field, 11 - end of message.
+ * Fields are packed LSB first. The first field starts with 6-bit TCODE followed by fixed
+ * length fields of the message. Direct branches are not traced, so only the addresses of
+ * indirect branch targets and synchronization points are known along with the number of
+ * instructions executed between them. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include "target.h"
+#include "image.h"
+#include "xtensa_trax.h"
+
+#define XTENSA_TRAX_MSEO_END_FIELD      0x1
+#define XTENSA_TRAX_MSEO_END_MSG        0x3
+/* Longer messages are considered to be corrupted */
+#define XTENSA_TRAX_MSG_LEN_MAX         32
+/* Size of the chunks trace file is read with */
+#define XTENSA_TRAX_READ_CHUNK_SZ       4096
+/* Number of the hottest functions printed to the console */
+#define XTENSA_TRAX_HIST_PRINT_MAX      10
+
+static void xtensa_trax_msg_reset(struct xtensa_trax_decoder *dec)
+{
+	memset(dec->fields, 0, sizeof(dec->fields));
+	memset(dec->fields_bits, 0, sizeof(dec->fields_bits));
+	dec->fields_num = 0;
+	dec->msg_len = 0;
+}
+
+void xtensa_trax_decoder_init(struct xtensa_trax_decoder *dec,
+	void (*msg_handler)(struct xtensa_trax_decoder *dec, const struct xtensa_trax_msg *msg),
+	void *priv)
+{
+	memset(dec, 0, sizeof(*dec));
+	dec->msg_handler = msg_handler;
+	dec->priv = priv;
+}
+
+static void xtensa_trax_msg_process(struct xtensa_trax_decoder *dec)
+{
+	struct xtensa_trax_msg msg = { 0 };
+	uint64_t vals[XTENSA_TRAX_MSG_FIELDS_MAX] = { 0 };
+	int vals_num = 0;
+
+	if (dec->fields_num == 0)
+		return;
+	msg.tcode = dec->fields[0] & 0x3F;
+	/* the rest of the first field holds fixed length fields and the first variable one */
+	if (dec->fields_bits[0] > 6)
+		vals[vals_num++] = dec->fields[0] >> 6;
+	for (int i = 1; i < dec->fields_num; i++)
+		vals[vals_num++] = dec->fields[i];
+
+	switch (msg.tcode) {
+		case XTENSA_TRAX_TCODE_IBR:
+		case XTENSA_TRAX_TCODE_IBR_SYNC:
+			if (vals_num < 2)
+				goto _error;
+			msg.type = vals[0] & 0x3;
+			msg.icnt = vals[0] >> 2;
+			if (msg.tcode == XTENSA_TRAX_TCODE_IBR_SYNC) {
+				msg.addr = vals[1];
+				msg.addr_valid = true;
+			} else if (dec->last_addr_valid) {
+				/* address is compressed relative to the previous one */
+				msg.addr = dec->last_addr ^ (uint32_t)vals[1];
+				msg.addr_valid = true;
+			}
+			break;
+		case XTENSA_TRAX_TCODE_SYNC:
+			if (vals_num < 2)
+				goto _error;
+			msg.type = vals[0] & 0xF;
+			msg.icnt = vals[0] >> 4;
+			msg.addr = vals[1];
+			msg.addr_valid = true;
+			break;
+		case XTENSA_TRAX_TCODE_CORR:
+			if (vals_num < 1)
+				goto _error;
+			msg.type = vals[0] & 0xF;
+			msg.icnt = vals[0] >> 6;
+			break;
+		default:
+			LOG_DEBUG("Unsupported TRAX message %d", msg.tcode);
+			dec->msgs_num++;
+			return;
+	}
+	if (msg.addr_valid) {
+		dec->last_addr = msg.addr;
+		dec->last_addr_valid = true;
+	}
+	dec->msgs_num++;
+	if (dec->msg_handler)
+		dec->msg_handler(dec, &msg);
+	return;
+
+_error:
+	LOG_DEBUG("Malformed TRAX message %d", msg.tcode);
+	dec->errors_num++;
+}
+
+/* Decodes the next chunk of trace data. Decoding starts from the first message boundary, so
+ * the data can begin anywhere in the trace memory. Memory usage does not depend on trace size. */
+void xtensa_trax_decode(struct xtensa_trax_decoder *dec, const uint8_t *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		uint8_t mseo = data[i] & 0x3;
+		uint8_t mdo = data[i] >> 2;
+
+		if (!dec->synced) {
+			if (mseo == XTENSA_TRAX_MSEO_END_MSG) {
+				dec->synced = true;
+				xtensa_trax_msg_reset(dec);
+			}
+			continue;
+		}
+		if (mseo == 0x2 || ++dec->msg_len > XTENSA_TRAX_MSG_LEN_MAX) {
+			/* corrupted data, wait for the next message */
+			dec->errors_num++;
+			dec->synced = false;
+			dec->last_addr_valid = false;
+			continue;
+		}
+		if (dec->fields_num < XTENSA_TRAX_MSG_FIELDS_MAX) {
+			int f = dec->fields_num;
+			if (dec->fields_bits[f] < 64) {
+				dec->fields[f] |= (uint64_t)mdo << dec->fields_bits[f];
+				dec->fields_bits[f] += 6;
+			}
+			if (mseo & XTENSA_TRAX_MSEO_END_FIELD)
+				dec->fields_num++;
+		}
+		if (mseo == XTENSA_TRAX_MSEO_END_MSG) {
+			xtensa_trax_msg_process(dec);
+			xtensa_trax_msg_reset(dec);
+		}
+	}
+}
+
+struct xtensa_trax_hist {
+	struct image_symbol *syms;
+	size_t syms_num;
+	/* instructions executed in the function */
+	uint64_t *insns;
+	/* number of times the function was entered by traced branch or sync */
+	uint64_t *entries;
+	uint64_t unknown_insns;
+	uint32_t prev_addr;
+	bool prev_addr_valid;
+	FILE *out;
+};
+
+static int xtensa_trax_sym_find(struct xtensa_trax_hist *hist, uint32_t addr)
+{
+	size_t lo = 0, hi = hist->syms_num;
+
+	/* find the last symbol starting at or below the address */
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (hist->syms[mid].address <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return -1;
+	struct image_symbol *sym = &hist->syms[lo - 1];
+	if (sym->size != 0 && addr - sym->address >= sym->size)
+		return -1;
+	return lo - 1;
+}
+
+static const char *xtensa_trax_msg_name(const struct xtensa_trax_msg *msg)
+{
+	switch (msg->tcode) {
+		case XTENSA_TRAX_TCODE_IBR:
+			return msg->type ? "exc" : "ibr";
+		case XTENSA_TRAX_TCODE_IBR_SYNC:
+			return msg->type ? "excs" : "ibrs";
+		case XTENSA_TRAX_TCODE_SYNC:
+			return "sync";
+		default:
+			return "corr";
+	}
+}
+
+static void xtensa_trax_hist_msg_handler(struct xtensa_trax_decoder *dec,
+	const struct xtensa_trax_msg *msg)
+{
+	struct xtensa_trax_hist *hist = dec->priv;
+	int idx = -1;
+
+	/* instructions counted by the message have been executed after the previous known address,
+	 * direct branches are not traced, so attribute them to the function containing it */
+	if (hist->prev_addr_valid)
+		idx = xtensa_trax_sym_find(hist, hist->prev_addr);
+	if (idx >= 0)
+		hist->insns[idx] += msg->icnt;
+	else
+		hist->unknown_insns += msg->icnt;
+
+	if (msg->addr_valid) {
+		idx = xtensa_trax_sym_find(hist, msg->addr);
+		if (idx >= 0)
+			hist->entries[idx]++;
+		hist->prev_addr = msg->addr;
+		hist->prev_addr_valid = true;
+	} else if (msg->tcode != XTENSA_TRAX_TCODE_CORR)
+		hist->prev_addr_valid = false;
+
+	if (!hist->out)
+		return;
+	fprintf(hist->out, "%-4s %8" PRIu32, xtensa_trax_msg_name(msg), msg->icnt);
+	if (!msg->addr_valid) {
+		fprintf(hist->out, " ?\n");
+		return;
+	}
+	fprintf(hist->out, " 0x%08" PRIx32, msg->addr);
+	if (idx >= 0)
+		fprintf(hist->out, " %s+0x%" PRIx32, hist->syms[idx].name,
+			msg->addr - hist->syms[idx].address);
+	fputc('\n', hist->out);
+}
+
+static struct xtensa_trax_hist *xtensa_trax_hist_sort_ctx;
+
+static int xtensa_trax_hist_compare(const void *a, const void *b)
+{
+	struct xtensa_trax_hist *hist = xtensa_trax_hist_sort_ctx;
+	size_t ia = *(const size_t *)a, ib = *(const size_t *)b;
+
+	/* by executed instructions, then by entries, descending */
+	if (hist->insns[ia] != hist->insns[ib])
+		return hist->insns[ia] > hist->insns[ib] ? -1 : 1;
+	if (hist->entries[ia] != hist->entries[ib])
+		return hist->entries[ia] > hist->entries[ib] ? -1 : 1;
+	return 0;
+}
+
+/* tracedecode <trace_file> <elf_file> [out_file] */
+COMMAND_HANDLER(xtensa_cmd_tracedecode)
+{
+	struct xtensa_trax_hist hist = { 0 };
+	struct xtensa_trax_decoder dec;
+	struct image image;
+	size_t *order = NULL;
+	uint8_t *chunk = NULL;
+	FILE *trace = NULL;
+	int res;
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	res = image_open(&image, CMD_ARGV[1], "elf");
+	if (res != ERROR_OK) {
+		command_print(CMD, "Failed to open ELF file '%s'!", CMD_ARGV[1]);
+		return res;
+	}
+	res = image_read_symbols(&image, &hist.syms, &hist.syms_num);
+	image_close(&image);
+	if (res != ERROR_OK) {
+		command_print(CMD, "Failed to read symbols from '%s'!", CMD_ARGV[1]);
+		return res;
+	}
+
+	res = ERROR_FAIL;
+	hist.insns = calloc(hist.syms_num + 1, sizeof(uint64_t));
+	hist.entries = calloc(hist.syms_num + 1, sizeof(uint64_t));
+	order = calloc(hist.syms_num + 1, sizeof(size_t));
+	chunk = malloc(XTENSA_TRAX_READ_CHUNK_SZ);
+	if (!hist.insns || !hist.entries || !order || !chunk) {
+		command_print(CMD, "Failed to alloc memory for trace decoding!");
+		goto _cleanup;
+	}
+	trace = fopen(CMD_ARGV[0], "rb");
+	if (!trace) {
+		command_print(CMD, "Failed to open trace file '%s'!", CMD_ARGV[0]);
+		goto _cleanup;
+	}
+	if (CMD_ARGC > 2) {
+		hist.out = fopen(CMD_ARGV[2], "w");
+		if (!hist.out) {
+			command_print(CMD, "Failed to open output file '%s'!", CMD_ARGV[2]);
+			goto _cleanup;
+		}
+		fprintf(hist.out, "# type icnt address function\n");
+	}
+
+	xtensa_trax_decoder_init(&dec, xtensa_trax_hist_msg_handler, &hist);
+	size_t rd;
+	while ((rd = fread(chunk, 1, XTENSA_TRAX_READ_CHUNK_SZ, trace)) > 0)
+		xtensa_trax_decode(&dec, chunk, rd);
+	if (ferror(trace)) {
+		command_print(CMD, "Failed to read trace file '%s'!", CMD_ARGV[0]);
+		goto _cleanup;
+	}
+
+	for (size_t i = 0; i < hist.syms_num; i++)
+		order[i] = i;
+	xtensa_trax_hist_sort_ctx = &hist;
+	qsort(order, hist.syms_num, sizeof(size_t), xtensa_trax_hist_compare);
+	xtensa_trax_hist_sort_ctx = NULL;
+
+	command_print(CMD, "Decoded %" PRIu64 " messages, %" PRIu64 " errors",
+		dec.msgs_num, dec.errors_num);
+	if (hist.out)
+		fprintf(hist.out, "# insns entries function\n");
+	for (size_t i = 0; i < hist.syms_num; i++) {
+		size_t idx = order[i];
+		if (hist.insns[idx] == 0 && hist.entries[idx] == 0)
+			break;
+		if (hist.out)
+			fprintf(hist.out, "%" PRIu64 " %" PRIu64 " %s\n",
+				hist.insns[idx], hist.entries[idx], hist.syms[idx].name);
+		if (i < XTENSA_TRAX_HIST_PRINT_MAX)
+			command_print(CMD, "%12" PRIu64 " %8" PRIu64 " %s",
+				hist.insns[idx], hist.entries[idx], hist.syms[idx].name);
+	}
+	if (hist.unknown_insns)
+		command_print(CMD, "%12" PRIu64 " insns outside of known functions",
+			hist.unknown_insns);
+	res = ERROR_OK;
+
+_cleanup:
+	if (hist.out)
+		fclose(hist.out);
+	if (trace)
+		fclose(trace);
+	free(chunk);
+	free(order);
+	free(hist.entries);
+	free(hist.insns);
+	image_free_symbols(hist.syms, hist.syms_num);
+	return res;
+}
+
+const struct command_registration xtensa_trax_command_handlers[] = {
+	{
+		.name = "tracedecode",
+		.handler = xtensa_cmd_tracedecode,
+		.mode = COMMAND_ANY,
+		.help =
+			"Tracing: Decode trace dump using function symbols from ELF file. Writes branch history and per-function histogram to output file, prints the hottest functions.",
+		.usage = "<trace_file> <elf_file> [out_file]",
+	},
+	COMMAND_REGISTRATION_DONE
+};
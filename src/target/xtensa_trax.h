@@ -0,0 +1,68 @@
+/***************************************************************************
+ *   Xtensa TRAX trace decoder for OpenOCD                                 *
+ *   Copyright (C) 2019 Espressif Systems Ltd.                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+#ifndef XTENSA_TRAX_H__
+#define XTENSA_TRAX_H__
+
+#include "command.h"
+
+/* TRAX message type codes */
+#define XTENSA_TRAX_TCODE_IBR           4	/* indirect branch */
+#define XTENSA_TRAX_TCODE_SYNC          9	/* synchronization */
+#define XTENSA_TRAX_TCODE_IBR_SYNC      12	/* indirect branch with synchronization */
+#define XTENSA_TRAX_TCODE_CORR          33	/* program trace correlation */
+
+/* Max number of fields in TRAX message */
+#define XTENSA_TRAX_MSG_FIELDS_MAX      4
+
+struct xtensa_trax_msg {
+	uint8_t tcode;
+	/* BTYPE for branch messages, SYNC or EVCODE for others */
+	uint8_t type;
+	/* number of instructions executed since the previous message */
+	uint32_t icnt;
+	/* full target address, valid when 'addr_valid' is set */
+	uint32_t addr;
+	bool addr_valid;
+};
+
+/* Stream decoder state, trace data can be fed in chunks of any size */
+struct xtensa_trax_decoder {
+	bool synced;
+	uint64_t fields[XTENSA_TRAX_MSG_FIELDS_MAX];
+	uint8_t fields_bits[XTENSA_TRAX_MSG_FIELDS_MAX];
+	int fields_num;
+	int msg_len;
+	/* last known full address, base for the compressed addresses */
+	uint32_t last_addr;
+	bool last_addr_valid;
+	uint64_t msgs_num;
+	uint64_t errors_num;
+	void (*msg_handler)(struct xtensa_trax_decoder *dec, const struct xtensa_trax_msg *msg);
+	void *priv;
+};
+
+void xtensa_trax_decoder_init(struct xtensa_trax_decoder *dec,
+	void (*msg_handler)(struct xtensa_trax_decoder *dec, const struct xtensa_trax_msg *msg),
+	void *priv);
+void xtensa_trax_decode(struct xtensa_trax_decoder *dec, const uint8_t *data, size_t size);
+
+extern const struct command_registration xtensa_trax_command_handlers[];
+
+#endif	/*XTENSA_TRAX_H__*/
@@ -2,6 +2,7 @@ import logging
 import unittest
 import tempfile
 import filecmp
+import re
 import debug_backend as dbg
 from debug_backend_tests import *
 
@@ -43,6 +44,56 @@ class FlasherTestsImpl:
         self.gdb.monitor_run('flash read_bank 0 %s 0x%x %d' % (dbg.fixup_path(fname2), ESP32_APP_FLASH_OFF + ESP32_APP_FLASH_SZ, size*1024), tmo=120)
         self.assertTrue(filecmp.cmp(fname1, fname2))
 
+    def test_skip_unchanged(self):
+        """
+            This test checks that writing with skipping of unchanged sectors works.
+            1) Create test binary file and write it to the flash.
+            2) Modify some bytes in the middle of the file.
+            3) Write modified file to the flash skipping unchanged sectors.
+            4) Check that unchanged sectors were skipped if stub supports hashing.
+            5) Write small chunk at the offset which is not sector aligned skipping unchanged sectors.
+            6) Read written data to another file.
+            7) Compare files, data around the chunk must be preserved.
+        """
+        fhnd,fname1 = tempfile.mkstemp()
+        fbin = os.fdopen(fhnd, 'wb')
+        size = 256
+        get_logger().debug('Generate random file %dKB "%s"', size, fname1)
+        for i in range(size):
+            fbin.write(os.urandom(1024))
+        fbin.close()
+        self.gdb.target_program(fname1, ESP32_APP_FLASH_OFF + ESP32_APP_FLASH_SZ, actions='', tmo=130)
+        with open(fname1, 'r+b') as fbin:
+            fbin.seek(size*1024//2 + 100)
+            fbin.write(os.urandom(5000))
+        self.gdb.target_program(fname1, ESP32_APP_FLASH_OFF + ESP32_APP_FLASH_SZ, actions='skip_unchanged', tmo=130)
+        stats = self.oocd.cmd_exec('esp skip_unchanged')
+        get_logger().debug('Skip unchanged stats: %s', stats)
+        m = re.search(r'last write: (\d+) of (\d+) sectors changed', stats)
+        self.assertTrue(m is not None)
+        if 'not supported' not in stats:
+            self.assertTrue(int(m.group(1)) < int(m.group(2)))
+        # unaligned chunk spanning two sectors
+        chunk_off = size*1024//4 + 4096 - 1000
+        chunk = os.urandom(3000)
+        fhnd,fname3 = tempfile.mkstemp()
+        fbin = os.fdopen(fhnd, 'wb')
+        fbin.write(chunk)
+        fbin.close()
+        with open(fname1, 'r+b') as fbin:
+            fbin.seek(chunk_off)
+            fbin.write(chunk)
+        self.gdb.monitor_run('esp skip_unchanged on')
+        try:
+            self.gdb.monitor_run('flash write_bank 0 %s 0x%x' % (dbg.fixup_path(fname3), ESP32_APP_FLASH_OFF + ESP32_APP_FLASH_SZ + chunk_off), tmo=120)
+        finally:
+            self.gdb.monitor_run('esp skip_unchanged off')
+        fhnd,fname2 = tempfile.mkstemp()
+        fbin = os.fdopen(fhnd, 'wb')
+        fbin.close()
+        self.gdb.monitor_run('flash read_bank 0 %s 0x%x %d' % (dbg.fixup_path(fname2), ESP32_APP_FLASH_OFF + ESP32_APP_FLASH_SZ, size*1024), tmo=120)
+        self.assertTrue(filecmp.cmp(fname1, fname2))
+
     def test_cache_handling(self):
         """
             This test checks that flasher does not corrupts cache config registers when setting breakpoints.